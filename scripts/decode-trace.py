@@ -0,0 +1,43 @@
+#!/usr/bin/env python3
+# Decode an audio thread trace written by traceDump() (see src/common/Trace.h).
+#
+# usage: scripts/decode-trace.py trace.bin
+
+import struct
+import sys
+
+TYPES = {
+    1: "grain-start",
+    2: "grain-stop",
+    3: "grain-drop",
+    4: "freeze",
+    5: "max-delay",
+    6: "once-capture",
+}
+
+TICKS_PER_SECOND = 1.0e9
+
+
+def main(path):
+    with open(path, "rb") as f:
+        magic, count = struct.unpack("<II", f.read(8))
+        if magic != 0x43525459:
+            sys.exit("%s: not a trace file" % path)
+        # the 32-bit tick counter wraps every few seconds, so the time since
+        # the first event is built up from the steps between events
+        prev = None
+        total = 0
+        for _ in range(count):
+            ticks, kind, index, a, b = struct.unpack("<IHHff", f.read(16))
+            if prev is not None:
+                total += (ticks - prev) & 0xFFFFFFFF
+            prev = ticks
+            t = total / TICKS_PER_SECOND
+            name = TYPES.get(kind, "type-%d" % kind)
+            print("%12.6f %-13s %3d %12.4f %12.4f" % (t, name, index, a, b))
+
+
+if __name__ == "__main__":
+    if len(sys.argv) != 2:
+        sys.exit("usage: %s trace.bin" % sys.argv[0])
+    main(sys.argv[1])
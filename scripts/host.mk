@@ -0,0 +1,36 @@
+# Host builds of the object code, shared by the renderer and the tests. The
+# objects are linked against the SDK's host libraries instead of being
+# loaded from a package, so the Lua bindings are not needed.
+
+include scripts/env.mk
+
+ifneq ($(ARCH),linux)
+  $(error Host tools only build for ARCH=linux)
+endif
+
+HOST_DIR  = $(PROFILE)/$(ARCH)/host
+HOST_MODS = fdelay yloop
+
+HOST_SOURCES := $(call rwildcard, src/common, *.cpp)
+HOST_SOURCES += $(foreach mod,$(HOST_MODS),$(call rwildcard, src/mods/$(mod), *.cpp))
+HOST_HEADERS := $(call rwildcard, src/common, *.h)
+HOST_HEADERS += $(foreach mod,$(HOST_MODS),$(call rwildcard, src/mods/$(mod), *.h))
+HOST_OBJECTS  = $(addprefix $(HOST_DIR)/,$(HOST_SOURCES:%.cpp=%.o))
+
+# The SDK's host build of the od and hal libraries.
+HOST_LIBS ?= $(SDKPATH)/$(PROFILE)/$(ARCH)/od/libod.a $(SDKPATH)/$(PROFILE)/$(ARCH)/hal/libhal.a
+
+HOST_INCLUDES  = src/common $(addprefix src/mods/,$(HOST_MODS))
+HOST_INCLUDES += $(SDKPATH) $(SDKPATH)/arch/$(ARCH) $(SDKPATH)/emu
+
+CFLAGS += -Wall -Wno-deprecated-declarations -msse4 -O3 -ftree-vectorize -ffast-math
+CFLAGS += -DBUILDOPT_TESTING
+
+.DEFAULT_GOAL := all
+
+$(HOST_OBJECTS): $(HOST_HEADERS) scripts/host.mk
+
+$(HOST_DIR)/%.o: %.cpp
+	@echo [C++ $<]
+	@mkdir -p $(@D)
+	@$(CPP) $(CFLAGS) $(addprefix -I,$(HOST_INCLUDES)) -std=gnu++11 -c $< -o $@
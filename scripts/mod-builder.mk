@@ -132,6 +132,19 @@ dist-clean:
 emu: install
 	cd $(SDKPATH); ./testing/$(ARCH)/emu/emu.elf
 
+# Real-time allocation audit: the emulator runs with an allocator interposer
+# that reports any malloc/free made inside an instrumented process().
+# Set AUDIT_ABORT=1 to abort on the first violation.
+AUDIT_LIB = $(OUT_DIR)/libaudit.so
+
+$(AUDIT_LIB): src/audit/AllocationInterpose.cpp $(COMMON_DIR)/AllocationAudit.cpp $(COMMON_HEADERS)
+	@echo [AUDIT $@]
+	@mkdir -p $(@D)
+	@$(CPP) $(CFLAGS) -std=gnu++11 -shared -o $@ src/audit/AllocationInterpose.cpp $(COMMON_DIR)/AllocationAudit.cpp
+
+emu-audit: install $(AUDIT_LIB)
+	cd $(SDKPATH); LD_PRELOAD=$(abspath $(AUDIT_LIB)) ./testing/$(ARCH)/emu/emu.elf
+
 install: $(PACKAGE_FILE)
 	cp $(PACKAGE_FILE) ~/.od/rear
 
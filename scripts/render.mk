@@ -0,0 +1,56 @@
+# Offline parameter-sweep renderer, a host tool that links the fdelay and
+# yloop objects against the SDK's host libraries.
+#
+#   make render
+#   testing/linux/render/render -j 8 -o out sweep.txt in.wav
+#
+#   make render-check
+#
+# render-check renders the grids in src/render/examples at the ER-301's
+# frame length as the reference, then again at an odd frame length, and
+# fails when any output differs from its reference.
+
+include scripts/host.mk
+
+OUT_DIR    = $(PROFILE)/$(ARCH)/render
+RENDER_BIN = $(OUT_DIR)/render
+RENDER_DIR = src/render
+
+RENDER_SOURCES := $(call rwildcard, $(RENDER_DIR), *.cpp)
+RENDER_HEADERS := $(call rwildcard, $(RENDER_DIR), *.h)
+RENDER_OBJECTS  = $(addprefix $(OUT_DIR)/,$(RENDER_SOURCES:%.cpp=%.o))
+
+CHECK_DIR         = $(OUT_DIR)/check
+CHECK_GRIDS      := $(wildcard $(RENDER_DIR)/examples/*.txt)
+CHECK_INPUT       = $(CHECK_DIR)/input.wav
+CHECK_FRAMELENGTH = 37
+CHECK_TOLERANCE   = 1e-6
+
+all: $(RENDER_BIN)
+
+check: $(RENDER_BIN)
+	@mkdir -p $(CHECK_DIR)
+	@$(RENDER_BIN) --generate $(CHECK_INPUT) 3
+	@set -e; for grid in $(CHECK_GRIDS); do \
+	  name=`basename $$grid .txt`; \
+	  echo [CHECK $$name]; \
+	  $(RENDER_BIN) -f 128 -o $(CHECK_DIR)/$$name-ref $$grid $(CHECK_INPUT); \
+	  $(RENDER_BIN) -f $(CHECK_FRAMELENGTH) -o $(CHECK_DIR)/$$name -r $(CHECK_DIR)/$$name-ref \
+	    -t $(CHECK_TOLERANCE) $$grid $(CHECK_INPUT); \
+	done
+
+$(RENDER_OBJECTS): $(RENDER_HEADERS) $(HOST_HEADERS) scripts/render.mk
+
+$(RENDER_BIN): $(RENDER_OBJECTS) $(HOST_OBJECTS)
+	@echo [LINK $@]
+	@$(CPP) $(CFLAGS) -o $@ $(RENDER_OBJECTS) $(HOST_OBJECTS) $(HOST_LIBS) -pthread -lm
+
+$(OUT_DIR)/%.o: %.cpp
+	@echo [C++ $<]
+	@mkdir -p $(@D)
+	@$(CPP) $(CFLAGS) $(addprefix -I,$(RENDER_DIR) $(HOST_INCLUDES)) -std=gnu++11 -c $< -o $@
+
+clean:
+	rm -rf $(OUT_DIR)
+
+.PHONY: all check clean
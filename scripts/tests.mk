@@ -0,0 +1,29 @@
+# Host tests of the object code, one program per src/tests/*Test.cpp. A test
+# prints what failed and exits non-zero.
+#
+#   make tests
+
+include scripts/host.mk
+
+OUT_DIR   = $(PROFILE)/$(ARCH)/tests
+TESTS_DIR = src/tests
+
+TEST_SOURCES := $(wildcard $(TESTS_DIR)/*Test.cpp)
+TEST_BINS     = $(addprefix $(OUT_DIR)/,$(notdir $(TEST_SOURCES:%.cpp=%)))
+
+all: $(TEST_BINS)
+	@set -e; for test in $(TEST_BINS); do \
+	  echo [TEST $$test]; \
+	  $$test; \
+	done
+
+$(OUT_DIR)/%: $(TESTS_DIR)/%.cpp $(TESTS_DIR)/Test.h $(HOST_OBJECTS)
+	@echo [LINK $@]
+	@mkdir -p $(@D)
+	@$(CPP) $(CFLAGS) $(addprefix -I,$(TESTS_DIR) $(HOST_INCLUDES)) -std=gnu++11 -o $@ $< \
+	  $(HOST_OBJECTS) $(HOST_LIBS) -pthread -lm
+
+clean:
+	rm -rf $(OUT_DIR)
+
+.PHONY: all clean
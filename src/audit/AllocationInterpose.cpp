@@ -0,0 +1,66 @@
+// Allocator interposer for the real-time allocation audit, see
+// src/common/AllocationAudit.h. Built as libaudit.so and loaded with
+// LD_PRELOAD so it sits in front of glibc for the whole process.
+
+#include <AllocationAudit.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef BUILDOPT_AUDIT
+
+extern "C"
+{
+  void *__libc_malloc(size_t size);
+  void *__libc_calloc(size_t count, size_t size);
+  void *__libc_realloc(void *ptr, size_t size);
+  void *__libc_memalign(size_t alignment, size_t size);
+  void __libc_free(void *ptr);
+
+  void *malloc(size_t size)
+  {
+    common::auditAllocation("malloc", size);
+    return __libc_malloc(size);
+  }
+
+  void *calloc(size_t count, size_t size)
+  {
+    common::auditAllocation("calloc", count * size);
+    return __libc_calloc(count, size);
+  }
+
+  void *realloc(void *ptr, size_t size)
+  {
+    common::auditAllocation("realloc", size);
+    return __libc_realloc(ptr, size);
+  }
+
+  int posix_memalign(void **ptr, size_t alignment, size_t size)
+  {
+    common::auditAllocation("posix_memalign", size);
+    *ptr = __libc_memalign(alignment, size);
+    return *ptr ? 0 : 12 /* ENOMEM */;
+  }
+
+  void free(void *ptr)
+  {
+    if (ptr)
+    {
+      common::auditAllocation("free", 0);
+    }
+    __libc_free(ptr);
+  }
+}
+
+__attribute__((constructor)) static void auditInit()
+{
+  const char *value = getenv("AUDIT_ABORT");
+  common::auditSetAbort(value && value[0] == '1');
+}
+
+__attribute__((destructor)) static void auditReport()
+{
+  fprintf(stderr, "audit: %d allocator calls inside process()\n",
+          common::auditViolations());
+}
+
+#endif
@@ -0,0 +1,48 @@
+#include <AllocationAudit.h>
+
+#ifdef BUILDOPT_AUDIT
+
+#include <atomic>
+#include <stdio.h>
+#include <stdlib.h>
+
+namespace common
+{
+
+  thread_local int auditDepth = 0;
+
+  static std::atomic<int> violations{0};
+  static bool abortOnViolation = false;
+
+  void auditAllocation(const char *function, size_t size)
+  {
+    if (auditDepth == 0)
+    {
+      return;
+    }
+
+    // stdio may allocate, don't count that
+    int depth = auditDepth;
+    auditDepth = 0;
+    violations++;
+    fprintf(stderr, "audit: %s(%u) inside process()\n", function, (unsigned)size);
+    if (abortOnViolation)
+    {
+      abort();
+    }
+    auditDepth = depth;
+  }
+
+  int auditViolations()
+  {
+    return violations;
+  }
+
+  void auditSetAbort(bool abort)
+  {
+    abortOnViolation = abort;
+  }
+
+} /* namespace common */
+
+#endif
@@ -0,0 +1,59 @@
+#pragma once
+
+// Real-time allocation audit.
+//
+// AUDIT_PROCESS() at the top of a process() marks the audio thread as being
+// inside a mod object for the rest of that scope. When libaudit.so (built
+// from src/audit with `make <mod>-emu-audit`) is preloaded into the emulator
+// or linked into a host tool, every malloc/calloc/realloc/free (and so every
+// new/delete) made while marked is counted as a violation, or aborts when
+// AUDIT_ABORT=1 is set in the environment.
+//
+// Only Linux testing/debug builds carry the audit, AUDIT_PROCESS() expands to
+// nothing everywhere else.
+
+#if defined(BUILDOPT_TESTING) && defined(__linux__)
+#define BUILDOPT_AUDIT
+#endif
+
+#ifdef BUILDOPT_AUDIT
+
+#include <stddef.h>
+
+namespace common
+{
+
+  // depth of nested process() calls on this thread
+  extern thread_local int auditDepth;
+
+  class AuditScope
+  {
+  public:
+    inline AuditScope()
+    {
+      auditDepth++;
+    }
+
+    inline ~AuditScope()
+    {
+      auditDepth--;
+    }
+  };
+
+  // Called by the interposer for each allocator call.
+  void auditAllocation(const char *function, size_t size);
+  int auditViolations();
+  void auditSetAbort(bool abort);
+
+} /* namespace common */
+
+#define AUDIT_PROCESS() common::AuditScope auditScope
+
+#else
+
+#define AUDIT_PROCESS() \
+  do                    \
+  {                     \
+  } while (0)
+
+#endif
@@ -0,0 +1,112 @@
+#include <RangeMeter.h>
+#include <AllocationAudit.h>
+#include <od/config.h>
+#include <hal/simd.h>
+#include <hal/ops.h>
+
+namespace common
+{
+
+  // refresh rate the views are assumed to draw at
+  static const float displayRate = 30.0f;
+
+  RangeTap::RangeTap()
+  {
+    addParameter(mMinimum);
+    addParameter(mMaximum);
+    addParameter(mCenter);
+  }
+
+  RangeTap::~RangeTap()
+  {
+  }
+
+  RangeMeter::RangeMeter()
+  {
+    mPeriod = MAX(1, (int)(globalConfig.sampleRate / (displayRate * globalConfig.frameLength)));
+  }
+
+  RangeMeter::~RangeMeter()
+  {
+    int n = mCount;
+    for (int i = 0; i < n; i++)
+    {
+      mSignals[i].tap->release();
+    }
+  }
+
+  RangeTap *RangeMeter::watch(const std::string &name)
+  {
+    int n = mCount;
+    if (n == mMaxSignals)
+    {
+      return 0;
+    }
+
+    Signal &signal = mSignals[n];
+    signal.inlet.reset(new od::Inlet(name));
+    signal.tap = new RangeTap();
+    signal.tap->attach();
+    addInput(*signal.inlet);
+    mCount.store(n + 1, std::memory_order_release);
+    return signal.tap;
+  }
+
+  int RangeMeter::getSignalCount()
+  {
+    return mCount;
+  }
+
+  void RangeMeter::measure(Signal &signal)
+  {
+    float *in = signal.inlet->buffer();
+    float lo = in[0];
+    float hi = in[0];
+    int i = 0;
+
+    if (FRAMELENGTH >= 4)
+    {
+      float32x4_t mn = vld1q_f32(in);
+      float32x4_t mx = mn;
+      for (i = 4; i + 4 <= FRAMELENGTH; i += 4)
+      {
+        float32x4_t x = vld1q_f32(in + i);
+        mn = vminq_f32(mn, x);
+        mx = vmaxq_f32(mx, x);
+      }
+      float32x2_t mn2 = vpmin_f32(vget_low_f32(mn), vget_high_f32(mn));
+      float32x2_t mx2 = vpmax_f32(vget_low_f32(mx), vget_high_f32(mx));
+      lo = vget_lane_f32(vpmin_f32(mn2, mn2), 0);
+      hi = vget_lane_f32(vpmax_f32(mx2, mx2), 0);
+    }
+
+    // frame lengths that are not a multiple of 4
+    for (; i < FRAMELENGTH; i++)
+    {
+      lo = MIN(lo, in[i]);
+      hi = MAX(hi, in[i]);
+    }
+
+    RangeTap *tap = signal.tap;
+    tap->mMinimum.hardSet(lo);
+    tap->mMaximum.hardSet(hi);
+    tap->mCenter.hardSet(0.5f * (lo + hi));
+  }
+
+  void RangeMeter::process()
+  {
+    AUDIT_PROCESS();
+    int n = mCount.load(std::memory_order_acquire);
+    for (int i = mPhase; i < n; i += mPeriod)
+    {
+      measure(mSignals[i]);
+    }
+
+    mPhase++;
+    if (mPhase == mPeriod)
+    {
+      mPhase = 0;
+    }
+  }
+
+} /* namespace common */
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <od/objects/Object.h>
+#include <string>
+
+#ifndef SWIGLUA
+#include <atomic>
+#include <memory>
+#endif
+
+namespace common
+{
+
+  // What a view reads to draw the range of a control, the same parameters
+  // as app.MinMax. It does no work of its own, RangeMeter fills it in.
+  class RangeTap : public od::Object
+  {
+  public:
+    RangeTap();
+    virtual ~RangeTap();
+
+#ifndef SWIGLUA
+    od::Parameter mMinimum{"Min"};
+    od::Parameter mMaximum{"Max"};
+    od::Parameter mCenter{"Center"};
+#endif
+  };
+
+  // Measures the range of all control signals of a unit in one object.
+  //
+  // The views only redraw at display rate, so each signal is measured on one
+  // frame out of every display period, spread evenly over the frames of that
+  // period. The cost per frame stays at about one pass over one frame per
+  // display period's worth of signals, instead of a MinMax per control
+  // scanning every frame.
+  class RangeMeter : public od::Object
+  {
+  public:
+    RangeMeter();
+    virtual ~RangeMeter();
+
+    static const int mMaxSignals = 32;
+
+    // Adds an inlet with this name and returns the tap that shows its range,
+    // or 0 when the meter is full. UI thread.
+    RangeTap *watch(const std::string &name);
+    int getSignalCount();
+
+#ifndef SWIGLUA
+    virtual void process();
+#endif
+
+  private:
+#ifndef SWIGLUA
+    struct Signal
+    {
+      std::unique_ptr<od::Inlet> inlet;
+      RangeTap *tap = 0;
+    };
+
+    void measure(Signal &signal);
+
+    Signal mSignals[mMaxSignals];
+    // published after the signal is complete
+    std::atomic<int> mCount{0};
+#endif
+    int mPeriod = 1;
+    int mPhase = 0;
+  };
+
+} /* namespace common */
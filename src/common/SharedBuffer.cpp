@@ -0,0 +1,54 @@
+#include <SharedBuffer.h>
+#include <hal/ops.h>
+#include <string.h>
+
+namespace common
+{
+
+  SharedBuffer::SharedBuffer()
+  {
+  }
+
+  SharedBuffer::~SharedBuffer()
+  {
+    // the buffer is freed with the size it was allocated with
+    mSampleCount = mCapacity;
+  }
+
+  bool SharedBuffer::allocate(int channelCount, int frames)
+  {
+    mSampleCount = mCapacity;
+    mCapacity = 0;
+    if (!allocateBuffer(channelCount, frames))
+    {
+      return false;
+    }
+    memset(mpData, 0, sizeof(float) * channelCount * frames);
+    mCapacity = frames;
+    mHead = 0;
+    mLength = 1;
+    return true;
+  }
+
+  int SharedBuffer::getCapacity()
+  {
+    return mCapacity;
+  }
+
+  void SharedBuffer::publish(int head, int length)
+  {
+    mLength = CLAMP(1, mCapacity, length);
+    mHead = head;
+  }
+
+  int SharedBuffer::getHead()
+  {
+    return mHead;
+  }
+
+  int SharedBuffer::getLength()
+  {
+    return mLength;
+  }
+
+} /* namespace common */
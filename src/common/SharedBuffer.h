@@ -0,0 +1,45 @@
+#pragma once
+
+#include <od/audio/Sample.h>
+
+#ifndef SWIGLUA
+#include <atomic>
+#endif
+
+namespace common
+{
+
+  // Audio memory written by one object and read by objects in other mods,
+  // handed between units by name from Lua. Readers attach it with
+  // Grain::setSample like any other Sample and never write to it.
+  //
+  // The whole buffer is one ring of contiguous history, so grains wrap at
+  // mSampleCount like in any Sample. The owner publishes, once per frame, the
+  // frame it writes next and how many frames before it belong to the current
+  // audio (e.g. the loop length). Both sides run on the audio thread.
+  class SharedBuffer : public od::Sample
+  {
+  public:
+    SharedBuffer();
+    virtual ~SharedBuffer();
+
+    // UI thread
+    bool allocate(int channelCount, int frames);
+    int getCapacity();
+
+#ifndef SWIGLUA
+    // audio thread
+    void publish(int head, int length);
+    int getHead();
+    int getLength();
+#endif
+
+  private:
+    int mCapacity = 0;
+#ifndef SWIGLUA
+    std::atomic<int> mHead{0};
+    std::atomic<int> mLength{1};
+#endif
+  };
+
+} /* namespace common */
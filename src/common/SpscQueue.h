@@ -0,0 +1,73 @@
+#pragma once
+
+#include <atomic>
+#include <vector>
+
+namespace common
+{
+
+  // Bounded lock-free queue for exactly one producer thread and one consumer
+  // thread, e.g. the UI thread handing buffers to the audio thread. Neither
+  // push() nor pop() allocates. resize() must be called before either side
+  // uses the queue.
+  template <typename T>
+  class SpscQueue
+  {
+  public:
+    void resize(int capacity)
+    {
+      mSlots.assign(capacity + 1, T());
+      mHead = 0;
+      mTail = 0;
+    }
+
+    bool push(const T &value)
+    {
+      int tail = mTail.load(std::memory_order_relaxed);
+      int next = increment(tail);
+      if (next == mHead.load(std::memory_order_acquire))
+      {
+        // full
+        return false;
+      }
+      mSlots[tail] = value;
+      mTail.store(next, std::memory_order_release);
+      return true;
+    }
+
+    bool pop(T &value)
+    {
+      int head = mHead.load(std::memory_order_relaxed);
+      if (head == mTail.load(std::memory_order_acquire))
+      {
+        // empty
+        return false;
+      }
+      value = mSlots[head];
+      mHead.store(increment(head), std::memory_order_release);
+      return true;
+    }
+
+    int size()
+    {
+      int n = mTail.load(std::memory_order_acquire) - mHead.load(std::memory_order_acquire);
+      return n < 0 ? n + (int)mSlots.size() : n;
+    }
+
+    int capacity()
+    {
+      return (int)mSlots.size() - 1;
+    }
+
+  private:
+    inline int increment(int i)
+    {
+      return i + 1 == (int)mSlots.size() ? 0 : i + 1;
+    }
+
+    std::vector<T> mSlots;
+    std::atomic<int> mHead{0};
+    std::atomic<int> mTail{0};
+  };
+
+} /* namespace common */
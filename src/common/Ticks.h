@@ -0,0 +1,42 @@
+#pragma once
+
+#include <stdint.h>
+
+#if !defined(__arm__)
+#include <chrono>
+#endif
+
+namespace common
+{
+
+  // Cheap free running timestamp for profiling process() from inside an object.
+  // On the am335x this is the Cortex-A8 cycle counter (1 GHz), elsewhere it is
+  // the host steady clock in nanoseconds.
+  static inline uint32_t ticks()
+  {
+#if defined(__arm__)
+    uint32_t value;
+    asm volatile("mrc p15, 0, %0, c9, c13, 0"
+                 : "=r"(value));
+    return value;
+#else
+    return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+#endif
+  }
+
+  static const float ticksPerSecond = 1.0e9f;
+
+  // The cycle counter only counts once PMCR and PMCNTENSET enable it, which is
+  // up to the firmware. A stopped counter reads the same value every time.
+  static inline bool ticksRunning()
+  {
+    uint32_t first = ticks();
+    for (volatile int i = 0; i < 1000; i++)
+    {
+    }
+    return ticks() != first;
+  }
+
+} /* namespace common */
@@ -0,0 +1,75 @@
+#include <Trace.h>
+#include <stdio.h>
+
+namespace common
+{
+
+#ifdef BUILDOPT_TESTING
+
+  TraceEvent traceRing[traceSize];
+  std::atomic<uint32_t> traceHead{0};
+  std::atomic<uint32_t> traceTail{0};
+  std::atomic<uint32_t> traceLost{0};
+
+  int traceDump(const char *path)
+  {
+    FILE *file = fopen(path, "wb");
+    if (file == 0)
+    {
+      return -1;
+    }
+
+    uint32_t head = traceHead.load(std::memory_order_relaxed);
+    uint32_t tail = traceTail.load(std::memory_order_acquire);
+    uint32_t header[2] = {0x43525459 /* YTRC */, tail - head};
+    fwrite(header, sizeof(header), 1, file);
+    for (uint32_t i = head; i != tail; i++)
+    {
+      fwrite(&traceRing[i & traceMask], sizeof(TraceEvent), 1, file);
+    }
+    fclose(file);
+
+    traceHead.store(tail, std::memory_order_release);
+    return tail - head;
+  }
+
+  int traceCount()
+  {
+    return traceTail.load() - traceHead.load();
+  }
+
+  int traceDropped()
+  {
+    return traceLost.load();
+  }
+
+  bool traceEnabled()
+  {
+    return true;
+  }
+
+#else
+
+  int traceDump(const char *path)
+  {
+    return 0;
+  }
+
+  int traceCount()
+  {
+    return 0;
+  }
+
+  int traceDropped()
+  {
+    return 0;
+  }
+
+  bool traceEnabled()
+  {
+    return false;
+  }
+
+#endif
+
+} /* namespace common */
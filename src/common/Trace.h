@@ -0,0 +1,92 @@
+#pragma once
+
+#include <stdint.h>
+
+#ifndef SWIGLUA
+#include <Ticks.h>
+#include <atomic>
+#endif
+
+// Audio thread event trace.
+//
+// Events are 16 byte records written by the audio thread into a fixed-size
+// single-producer ring and drained to a file from Lua with traceDump(). The
+// file is decoded on the host with scripts/decode-trace.py.
+//
+// TRACE() compiles to nothing unless BUILDOPT_TESTING is defined (testing and
+// debug profiles), so release builds carry no cost.
+
+namespace common
+{
+
+  // event types
+  static const int TRACE_GRAIN_START = 1; // index, speed, duration (samples)
+  static const int TRACE_GRAIN_STOP = 2;  // index
+  static const int TRACE_GRAIN_DROP = 3;  // no free grain for a trigger
+  static const int TRACE_FREEZE = 4;      // a = 1 frozen, 0 thawed
+  static const int TRACE_MAX_DELAY = 5;   // a = new maximum delay (secs)
+  static const int TRACE_ONCE_CAPTURE = 6; // a = captured time (secs)
+
+  // Write all pending events to path. Returns the number of events written
+  // or -1 if the file could not be opened.
+  int traceDump(const char *path);
+  // Number of events waiting to be dumped.
+  int traceCount();
+  // Number of events lost because the ring was full.
+  int traceDropped();
+  bool traceEnabled();
+
+#ifndef SWIGLUA
+
+  struct TraceEvent
+  {
+    uint32_t ticks;
+    uint16_t type;
+    uint16_t index;
+    float a;
+    float b;
+  };
+
+#ifdef BUILDOPT_TESTING
+
+  // must be a power of two
+  static const uint32_t traceSize = 4096;
+  static const uint32_t traceMask = traceSize - 1;
+
+  extern TraceEvent traceRing[traceSize];
+  extern std::atomic<uint32_t> traceHead;
+  extern std::atomic<uint32_t> traceTail;
+  extern std::atomic<uint32_t> traceLost;
+
+  // Called from the audio thread only.
+  static inline void traceRecord(int type, int index, float a, float b)
+  {
+    uint32_t tail = traceTail.load(std::memory_order_relaxed);
+    if (tail - traceHead.load(std::memory_order_acquire) >= traceSize)
+    {
+      traceLost.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+    TraceEvent &event = traceRing[tail & traceMask];
+    event.ticks = ticks();
+    event.type = type;
+    event.index = index;
+    event.a = a;
+    event.b = b;
+    traceTail.store(tail + 1, std::memory_order_release);
+  }
+
+#define TRACE(type, index, a, b) common::traceRecord(type, index, a, b)
+
+#else
+
+#define TRACE(type, index, a, b) \
+  do                             \
+  {                              \
+  } while (0)
+
+#endif
+
+#endif
+
+} /* namespace common */
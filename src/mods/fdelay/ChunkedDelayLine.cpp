@@ -0,0 +1,261 @@
+#include <ChunkedDelayLine.h>
+#include <od/config.h>
+#include <hal/ops.h>
+#include <string.h>
+
+namespace fdelay
+{
+
+  // Seconds a surplus chunk is kept before it is handed back for freeing.
+  static const float holdOffTime = 5.0f;
+
+  // Chunks staged beyond the peak demand, so the delay can keep growing
+  // between two calls to maintain().
+  static const int spareChunks = 2;
+
+  ChunkedDelayLine::ChunkedDelayLine()
+  {
+  }
+
+  ChunkedDelayLine::~ChunkedDelayLine()
+  {
+    deallocate();
+  }
+
+  static inline int chunksFor(float samples, int maxChunks)
+  {
+    // one chunk for the partially written chunk and one for headroom
+    int n = (int)(samples + globalConfig.frameLength + 2) / ChunkedDelayLine::mChunkSize + 2;
+    return MIN(maxChunks, n);
+  }
+
+  void ChunkedDelayLine::allocate(float maxSecs, float initialSecs)
+  {
+    deallocate();
+
+    mMaxDelayInSamples = MAX(0.0f, maxSecs) * globalConfig.sampleRate;
+    mMaxChunks = chunksFor(mMaxDelayInSamples, 1 << 30);
+    mRing.assign(mMaxChunks, 0);
+    mStaged.resize(mMaxChunks);
+    mRetired.resize(mMaxChunks);
+
+    int n = chunksFor(MIN(maxSecs, initialSecs) * globalConfig.sampleRate, mMaxChunks);
+    for (int i = 0; i < n; i++)
+    {
+      mRing[i] = new float[mChunkSize]();
+    }
+    mRingChunks = n;
+    mAllocatedChunks = n;
+    mDemandChunks = n;
+    mPeakDemandChunks = n;
+    mReservedChunks = n;
+    mWriteIndex = 0;
+    mSurplusFrames = 0;
+    mCapacity = n * mChunkSize;
+
+    maintain();
+  }
+
+  void ChunkedDelayLine::deallocate()
+  {
+    mCapacity = 0;
+    for (int i = 0; i < mRingChunks; i++)
+    {
+      delete[] mRing[i];
+      mRing[i] = 0;
+    }
+    mRingChunks = 0;
+
+    float *chunk;
+    while (mStaged.pop(chunk))
+    {
+      delete[] chunk;
+    }
+    while (mRetired.pop(chunk))
+    {
+      delete[] chunk;
+    }
+    mAllocatedChunks = 0;
+  }
+
+  void ChunkedDelayLine::reserve(float secs)
+  {
+    mReservedChunks = chunksFor(secs * globalConfig.sampleRate, mMaxChunks);
+    maintain();
+  }
+
+  void ChunkedDelayLine::maintain()
+  {
+    float *chunk;
+    while (mRetired.pop(chunk))
+    {
+      delete[] chunk;
+      mAllocatedChunks--;
+    }
+
+    // Stage for the largest delay seen since the last call, so delays raised
+    // by CV or modulation get their memory without touching the knob.
+    int peak = mPeakDemandChunks.exchange(0);
+    int demand = MAX(mDemandChunks.load(), peak);
+    int reserved = mReservedChunks.load();
+    int target = MIN(mMaxChunks, MAX(demand, reserved) + spareChunks);
+    while (mAllocatedChunks < target)
+    {
+      if (!mStaged.push(new float[mChunkSize]()))
+      {
+        break;
+      }
+      mAllocatedChunks++;
+    }
+  }
+
+  float ChunkedDelayLine::getAllocatedSeconds()
+  {
+    return mAllocatedChunks * mChunkSize * globalConfig.samplePeriod;
+  }
+
+  float ChunkedDelayLine::getMaxSeconds()
+  {
+    return mMaxDelayInSamples * globalConfig.samplePeriod;
+  }
+
+  void ChunkedDelayLine::require(float delayInSamples)
+  {
+    int demand = chunksFor(MIN(delayInSamples, mMaxDelayInSamples), mMaxChunks);
+    mDemandChunks = demand;
+    if (demand > mPeakDemandChunks.load())
+    {
+      mPeakDemandChunks = demand;
+    }
+
+    if (demand > mRingChunks)
+    {
+      mSurplusFrames = 0;
+      grow();
+    }
+    else if (demand < mRingChunks)
+    {
+      // once the hold-off has passed, release one chunk per frame
+      mSurplusFrames++;
+      if (mSurplusFrames * globalConfig.frameLength * globalConfig.samplePeriod > holdOffTime)
+      {
+        shrink();
+      }
+    }
+    else
+    {
+      mSurplusFrames = 0;
+    }
+  }
+
+  void ChunkedDelayLine::grow()
+  {
+    float *chunk;
+    if (!mStaged.pop(chunk))
+    {
+      return;
+    }
+
+    // Insert right after the chunk being written. History behind the write
+    // head keeps its distance to the write head, the new chunk reads as silence.
+    int k = (mWriteIndex >> mChunkShift) + 1;
+    memmove(&mRing[k + 1], &mRing[k], sizeof(float *) * (mRingChunks - k));
+    mRing[k] = chunk;
+    mRingChunks++;
+    mCapacity += mChunkSize;
+  }
+
+  void ChunkedDelayLine::shrink()
+  {
+    if (mRingChunks <= 2)
+    {
+      return;
+    }
+
+    // Remove the chunk right after the one being written, it holds the
+    // oldest samples which are beyond the demanded delay.
+    int k = (mWriteIndex >> mChunkShift) + 1;
+    if (k == mRingChunks)
+    {
+      k = 0;
+    }
+
+    if (!mRetired.push(mRing[k]))
+    {
+      return;
+    }
+
+    if (k == 0)
+    {
+      // every chunk moves down by one, including the one being written
+      mWriteIndex -= mChunkSize;
+    }
+
+    memmove(&mRing[k], &mRing[k + 1], sizeof(float *) * (mRingChunks - k - 1));
+    mRingChunks--;
+    mRing[mRingChunks] = 0;
+    mCapacity -= mChunkSize;
+
+    // Staged chunks beyond the spares are not going to be needed either.
+    float *chunk;
+    while (mStaged.size() > spareChunks && mStaged.pop(chunk))
+    {
+      mRetired.push(chunk);
+    }
+  }
+
+  float ChunkedDelayLine::clampDelay(float delayInSamples)
+  {
+    float limit = MIN(mMaxDelayInSamples, (float)(mCapacity - globalConfig.frameLength - 2));
+    return CLAMP(0.0f, limit, delayInSamples);
+  }
+
+  int ChunkedDelayLine::getWriteIndex()
+  {
+    return mWriteIndex;
+  }
+
+  void ChunkedDelayLine::write(const float *in, int n)
+  {
+    while (n > 0)
+    {
+      int offset = mWriteIndex & mChunkMask;
+      int m = MIN(n, mChunkSize - offset);
+      memcpy(mRing[mWriteIndex >> mChunkShift] + offset, in, sizeof(float) * m);
+      in += m;
+      n -= m;
+      mWriteIndex += m;
+      if (mWriteIndex >= mCapacity)
+      {
+        mWriteIndex = 0;
+      }
+    }
+  }
+
+  inline float ChunkedDelayLine::at(int i)
+  {
+    return mRing[i >> mChunkShift][i & mChunkMask];
+  }
+
+  float ChunkedDelayLine::read(int index, float delay)
+  {
+    // Split the delay before subtracting, a float position loses the
+    // fraction as the index grows.
+    int whole = (int)delay;
+    float frac = delay - whole;
+    int i = index - whole;
+    if (i < 0)
+    {
+      i += mCapacity;
+    }
+    else if (i >= mCapacity)
+    {
+      i -= mCapacity;
+    }
+    int j = i == 0 ? mCapacity - 1 : i - 1;
+    float x0 = at(i);
+    float x1 = at(j);
+    return x0 + frac * (x1 - x0);
+  }
+
+} /* namespace fdelay */
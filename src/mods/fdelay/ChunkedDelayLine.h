@@ -0,0 +1,68 @@
+#pragma once
+
+#include <SpscQueue.h>
+#include <atomic>
+#include <vector>
+
+namespace fdelay
+{
+
+  // Mono delay memory made of fixed-size chunks linked into a ring. Only the
+  // chunks needed for the current delay (plus headroom) are kept in the ring.
+  //
+  // The audio thread never allocates: it grows the ring by taking chunks that
+  // were staged by maintain() and shrinks it by handing chunks back to be freed
+  // by maintain(). Both sides talk through lock-free queues.
+  class ChunkedDelayLine
+  {
+  public:
+    ChunkedDelayLine();
+    ~ChunkedDelayLine();
+
+    static const int mChunkShift = 14;
+    static const int mChunkSize = 1 << mChunkShift;
+    static const int mChunkMask = mChunkSize - 1;
+
+    // UI thread, maintain() is meant to be called periodically
+    void allocate(float maxSecs, float initialSecs);
+    void deallocate();
+    void reserve(float secs);
+    void maintain();
+    float getAllocatedSeconds();
+    float getMaxSeconds();
+
+    // audio thread
+    void require(float delayInSamples);
+    void write(const float *in, int n);
+    // the sample written delay samples before the one at index
+    float read(int index, float delay);
+    float clampDelay(float delayInSamples);
+    int getWriteIndex();
+
+  private:
+    void grow();
+    void shrink();
+    inline float at(int i);
+
+    // ring of chunks, at most mMaxChunks
+    std::vector<float *> mRing;
+    int mRingChunks = 0;
+    int mMaxChunks = 0;
+    int mCapacity = 0;
+    int mWriteIndex = 0;
+
+    common::SpscQueue<float *> mStaged;
+    common::SpscQueue<float *> mRetired;
+
+    // chunk counts published by the audio thread and the UI thread, the peak
+    // is the largest demand since the last maintain()
+    std::atomic<int> mDemandChunks{0};
+    std::atomic<int> mPeakDemandChunks{0};
+    std::atomic<int> mReservedChunks{0};
+    int mAllocatedChunks = 0;
+
+    float mMaxDelayInSamples = 0.0f;
+    int mSurplusFrames = 0;
+  };
+
+} /* namespace fdelay */
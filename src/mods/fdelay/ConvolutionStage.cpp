@@ -0,0 +1,243 @@
+#include <ConvolutionStage.h>
+#include <hal/simd.h>
+#include <hal/ops.h>
+#include <string.h>
+
+namespace fdelay
+{
+
+  void ConvolutionStage::allocate(int blockSize, int partitions)
+  {
+    mFFT.setSize(2 * blockSize);
+    mBlockSize = mFFT.getSize() / 2;
+    mSize = 2 * mBlockSize;
+    mStride = (mBlockSize + 1 + 3) & ~3;
+    mPartitions = MAX(0, partitions);
+    mUnitCount = 2 * mFFT.getPassCount() + mPartitions + 3;
+
+    mKernel.assign((size_t)mPartitions * 4 * mStride, 0.0f);
+    mDelayLine.assign((size_t)mPartitions * 4 * mStride, 0.0f);
+    mAccumulator.assign(4 * mStride, 0.0f);
+    mWorkRe.assign(mSize, 0.0f);
+    mWorkIm.assign(mSize, 0.0f);
+    mWindowLeft.assign(mSize, 0.0f);
+    mWindowRight.assign(mSize, 0.0f);
+    mOutputs[0].assign(2 * mBlockSize, 0.0f);
+    mOutputs[1].assign(2 * mBlockSize, 0.0f);
+    mFront = 0;
+    mHead = 0;
+    // nothing pending
+    mUnit = mUnitCount;
+  }
+
+  void ConvolutionStage::deallocate()
+  {
+    mPartitions = 0;
+    mUnitCount = 0;
+    mUnit = 0;
+    mKernel = std::vector<float>();
+    mDelayLine = std::vector<float>();
+  }
+
+  int ConvolutionStage::getBlockSize()
+  {
+    return mBlockSize;
+  }
+
+  int ConvolutionStage::getPartitions()
+  {
+    return mPartitions;
+  }
+
+  int ConvolutionStage::getUnitCount()
+  {
+    return mUnitCount;
+  }
+
+  inline float *ConvolutionStage::record(std::vector<float> &spectra, int partition)
+  {
+    return spectra.data() + (size_t)partition * 4 * mStride;
+  }
+
+  void ConvolutionStage::setKernel(int partition, const float *left, const float *right,
+                                   int n, float gain)
+  {
+    n = CLAMP(0, mBlockSize, n);
+    memset(mWorkRe.data(), 0, sizeof(float) * mSize);
+    memset(mWorkIm.data(), 0, sizeof(float) * mSize);
+    memcpy(mWorkRe.data(), left, sizeof(float) * n);
+    memcpy(mWorkIm.data(), right, sizeof(float) * n);
+    mFFT.forward(mWorkRe.data(), mWorkIm.data());
+
+    float *h = record(mKernel, partition);
+    separate(h);
+    // the inverse transform is unscaled
+    float scale = gain / mSize;
+    for (int i = 0; i < 4 * mStride; i++)
+    {
+      h[i] *= scale;
+    }
+  }
+
+  void ConvolutionStage::separate(float *spectrum)
+  {
+    const float *yr = mWorkRe.data();
+    const float *yi = mWorkIm.data();
+    float *leftRe = spectrum;
+    float *rightRe = spectrum + mStride;
+    float *leftIm = spectrum + 2 * mStride;
+    float *rightIm = spectrum + 3 * mStride;
+    int mask = mSize - 1;
+
+    // X(k) = (Y(k) + Y*(N - k)) / 2 for the real part of the input,
+    // (Y(k) - Y*(N - k)) / 2i for the imaginary part
+    for (int k = 0; k <= mBlockSize; k++)
+    {
+      int m = (mSize - k) & mask;
+      leftRe[k] = 0.5f * (yr[k] + yr[m]);
+      leftIm[k] = 0.5f * (yi[k] - yi[m]);
+      rightRe[k] = 0.5f * (yi[k] + yi[m]);
+      rightIm[k] = 0.5f * (yr[m] - yr[k]);
+    }
+  }
+
+  void ConvolutionStage::combine()
+  {
+    float *zr = mWorkRe.data();
+    float *zi = mWorkIm.data();
+    const float *leftRe = mAccumulator.data();
+    const float *rightRe = leftRe + mStride;
+    const float *leftIm = leftRe + 2 * mStride;
+    const float *rightIm = leftRe + 3 * mStride;
+
+    // Z = L + iR, the upper half follows from conjugate symmetry
+    for (int k = 0; k <= mBlockSize; k++)
+    {
+      zr[k] = leftRe[k] - rightIm[k];
+      zi[k] = leftIm[k] + rightRe[k];
+    }
+    for (int k = mBlockSize + 1; k < mSize; k++)
+    {
+      int m = mSize - k;
+      zr[k] = leftRe[m] + rightIm[m];
+      zi[k] = rightRe[m] - leftIm[m];
+    }
+  }
+
+  void ConvolutionStage::multiplyAdd(const float *x, const float *h)
+  {
+    // both channels in one pass: re parts are the first half of a record
+    int n = 2 * mStride;
+    float *ar = mAccumulator.data();
+    float *ai = ar + n;
+    const float *xr = x;
+    const float *xi = x + n;
+    const float *hr = h;
+    const float *hi = h + n;
+    for (int k = 0; k < n; k += 4)
+    {
+      float32x4_t a = vld1q_f32(xr + k);
+      float32x4_t b = vld1q_f32(xi + k);
+      float32x4_t c = vld1q_f32(hr + k);
+      float32x4_t d = vld1q_f32(hi + k);
+      float32x4_t re = vld1q_f32(ar + k);
+      float32x4_t im = vld1q_f32(ai + k);
+      re = vmlaq_f32(re, a, c);
+      re = vmlsq_f32(re, b, d);
+      im = vmlaq_f32(im, a, d);
+      im = vmlaq_f32(im, b, c);
+      vst1q_f32(ar + k, re);
+      vst1q_f32(ai + k, im);
+    }
+  }
+
+  void ConvolutionStage::push(const float *left, const float *right)
+  {
+    memmove(mWindowLeft.data(), mWindowLeft.data() + mBlockSize, sizeof(float) * mBlockSize);
+    memmove(mWindowRight.data(), mWindowRight.data() + mBlockSize, sizeof(float) * mBlockSize);
+    memcpy(mWindowLeft.data() + mBlockSize, left, sizeof(float) * mBlockSize);
+    memcpy(mWindowRight.data() + mBlockSize, right, sizeof(float) * mBlockSize);
+    mHead = mHead + 1 == mPartitions ? 0 : mHead + 1;
+    mUnit = 0;
+  }
+
+  void ConvolutionStage::unit(int u)
+  {
+    int passes = mFFT.getPassCount();
+    if (u < passes)
+    {
+      if (u == 0)
+      {
+        memcpy(mWorkRe.data(), mWindowLeft.data(), sizeof(float) * mSize);
+        memcpy(mWorkIm.data(), mWindowRight.data(), sizeof(float) * mSize);
+      }
+      mFFT.forwardPass(mWorkRe.data(), mWorkIm.data(), u);
+      return;
+    }
+    u -= passes;
+
+    if (u == 0)
+    {
+      separate(record(mDelayLine, mHead));
+      memset(mAccumulator.data(), 0, sizeof(float) * mAccumulator.size());
+      return;
+    }
+    u--;
+
+    if (u < mPartitions)
+    {
+      // partition p meets the input from p blocks ago
+      int k = mHead - u;
+      if (k < 0)
+      {
+        k += mPartitions;
+      }
+      multiplyAdd(record(mDelayLine, k), record(mKernel, u));
+      return;
+    }
+    u -= mPartitions;
+
+    if (u == 0)
+    {
+      combine();
+      return;
+    }
+    u--;
+
+    if (u < passes)
+    {
+      mFFT.inversePass(mWorkRe.data(), mWorkIm.data(), u);
+      return;
+    }
+
+    // overlap-save keeps the second half
+    float *out = mOutputs[1 - mFront].data();
+    memcpy(out, mWorkRe.data() + mBlockSize, sizeof(float) * mBlockSize);
+    memcpy(out + mBlockSize, mWorkIm.data() + mBlockSize, sizeof(float) * mBlockSize);
+  }
+
+  void ConvolutionStage::run(int units)
+  {
+    int end = MIN(mUnitCount, mUnit + units);
+    while (mUnit < end)
+    {
+      unit(mUnit++);
+    }
+  }
+
+  void ConvolutionStage::finish()
+  {
+    run(mUnitCount);
+  }
+
+  void ConvolutionStage::flip()
+  {
+    mFront = 1 - mFront;
+  }
+
+  const float *ConvolutionStage::getOutput(int channel)
+  {
+    return mOutputs[mFront].data() + channel * mBlockSize;
+  }
+
+} /* namespace fdelay */
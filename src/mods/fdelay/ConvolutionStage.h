@@ -0,0 +1,69 @@
+#pragma once
+
+#include <FFT.h>
+#include <vector>
+
+namespace fdelay
+{
+
+  // One uniformly partitioned overlap-save convolution of a stereo signal.
+  // Both channels share one complex FFT (left real, right imaginary) and are
+  // split into their own spectra afterwards. Input spectra go into a
+  // frequency-domain delay line that is multiplied with the kernel spectra
+  // of all partitions.
+  //
+  // The work for a block is a list of similar-sized units (FFT passes, one
+  // multiply-accumulate per partition, the inverse passes) that can be run
+  // all at once or a few per frame. Outputs are double buffered: flip() makes
+  // the last completed block readable.
+  class ConvolutionStage
+  {
+  public:
+    // UI thread
+    void allocate(int blockSize, int partitions);
+    void deallocate();
+    // n samples of each channel starting at the partition's offset in the
+    // impulse response, zero padded when n is short of the block size
+    void setKernel(int partition, const float *left, const float *right, int n, float gain);
+    int getBlockSize();
+    int getPartitions();
+    int getUnitCount();
+
+    // audio thread
+    void push(const float *left, const float *right);
+    void run(int units);
+    void finish();
+    void flip();
+    const float *getOutput(int channel);
+
+  private:
+    void unit(int u);
+    void separate(float *spectrum);
+    void combine();
+    void multiplyAdd(const float *x, const float *h);
+    inline float *record(std::vector<float> &spectra, int partition);
+
+    FFT mFFT;
+    int mBlockSize = 0;
+    int mSize = 0;
+    // floats per channel and part (re or im) of a spectrum, multiple of 4
+    int mStride = 0;
+    int mPartitions = 0;
+    int mUnitCount = 0;
+    int mUnit = 0;
+    int mHead = 0;
+
+    // spectra are laid out as left re, right re, left im, right im
+    std::vector<float> mKernel;
+    std::vector<float> mDelayLine;
+    std::vector<float> mAccumulator;
+    std::vector<float> mWorkRe;
+    std::vector<float> mWorkIm;
+    std::vector<float> mWindowLeft;
+    std::vector<float> mWindowRight;
+    // left then right, one block each
+    std::vector<float> mOutputs[2];
+    int mFront = 0;
+  };
+
+} /* namespace fdelay */
@@ -0,0 +1,185 @@
+#include <Convolver.h>
+#include <AllocationAudit.h>
+#include <od/config.h>
+#include <hal/ops.h>
+#include <math.h>
+#include <string.h>
+
+namespace fdelay
+{
+  Convolver::Convolver(float maxSecs)
+  {
+    addInput(mLeftInput);
+    addInput(mRightInput);
+    addOutput(mLeftOutput);
+    addOutput(mRightOutput);
+    addOption(mPartitioning);
+
+    mMaxSeconds = MAX(0.0f, maxSecs);
+    mInput.assign(2 * mHeadBlock, 0.0f);
+    mOutput.assign(2 * mHeadBlock, 0.0f);
+    mPending.assign(2 * mTailBlock, 0.0f);
+  }
+
+  Convolver::~Convolver()
+  {
+  }
+
+  float Convolver::getLength()
+  {
+    return mLength;
+  }
+
+  float Convolver::getMaxLength()
+  {
+    return mMaxSeconds;
+  }
+
+  static inline int blocksFor(int samples, int blockSize)
+  {
+    return (samples + blockSize - 1) / blockSize;
+  }
+
+  bool Convolver::setSample(od::Sample *sample)
+  {
+    mEnabled = false;
+    mHead.deallocate();
+    mTail.deallocate();
+    mLength = 0.0f;
+
+    int length = 0;
+    if (sample && sample->mSampleCount > 0)
+    {
+      length = MIN((int)sample->mSampleCount, (int)(mMaxSeconds * globalConfig.sampleRate));
+    }
+    if (length == 0)
+    {
+      return false;
+    }
+
+    std::vector<float> left(length);
+    std::vector<float> right(length);
+    int rightChannel = sample->mChannelCount > 1 ? 1 : 0;
+    double leftEnergy = 0.0;
+    double rightEnergy = 0.0;
+    for (int i = 0; i < length; i++)
+    {
+      left[i] = sample->get(i, 0);
+      right[i] = sample->get(i, rightChannel);
+      leftEnergy += left[i] * left[i];
+      rightEnergy += right[i] * right[i];
+    }
+    // unit energy for the louder channel, keeps the balance of the IR
+    double energy = MAX(leftEnergy, rightEnergy);
+    float gain = energy > 0.0 ? 1.0f / sqrt(energy) : 0.0f;
+
+    int headLength = length;
+    if (mPartitioning.value() == CONVOLVER_TWO_STAGE)
+    {
+      headLength = MIN(length, 2 * mTailBlock);
+    }
+
+    mHead.allocate(mHeadBlock, blocksFor(headLength, mHeadBlock));
+    for (int p = 0; p < mHead.getPartitions(); p++)
+    {
+      int offset = p * mHeadBlock;
+      mHead.setKernel(p, &left[offset], &right[offset], headLength - offset, gain);
+    }
+
+    int tailLength = length - headLength;
+    if (tailLength > 0)
+    {
+      mTail.allocate(mTailBlock, blocksFor(tailLength, mTailBlock));
+      for (int p = 0; p < mTail.getPartitions(); p++)
+      {
+        int offset = headLength + p * mTailBlock;
+        mTail.setKernel(p, &left[offset], &right[offset], length - offset, gain);
+      }
+      int ticks = mTailBlock / mHeadBlock;
+      mTailUnitsPerBlock = (mTail.getUnitCount() + ticks - 1) / ticks;
+    }
+
+    memset(mInput.data(), 0, sizeof(float) * mInput.size());
+    memset(mOutput.data(), 0, sizeof(float) * mOutput.size());
+    mFill = 0;
+    mTailPosition = 0;
+    mLength = length * globalConfig.samplePeriod;
+    mEnabled = true;
+    return true;
+  }
+
+  void Convolver::processBlock()
+  {
+    float *inLeft = mInput.data();
+    float *inRight = inLeft + mHeadBlock;
+    float *outLeft = mOutput.data();
+    float *outRight = outLeft + mHeadBlock;
+
+    mHead.push(inLeft, inRight);
+    mHead.finish();
+    mHead.flip();
+    memcpy(outLeft, mHead.getOutput(0), sizeof(float) * mHeadBlock);
+    memcpy(outRight, mHead.getOutput(1), sizeof(float) * mHeadBlock);
+
+    if (mTail.getPartitions() == 0)
+    {
+      return;
+    }
+
+    // the tail output of the block before last, the tail IR starts two
+    // tail blocks in so it lines up
+    const float *tailLeft = mTail.getOutput(0) + mTailPosition;
+    const float *tailRight = mTail.getOutput(1) + mTailPosition;
+    for (int i = 0; i < mHeadBlock; i++)
+    {
+      outLeft[i] += tailLeft[i];
+      outRight[i] += tailRight[i];
+    }
+
+    memcpy(mPending.data() + mTailPosition, inLeft, sizeof(float) * mHeadBlock);
+    memcpy(mPending.data() + mTailBlock + mTailPosition, inRight, sizeof(float) * mHeadBlock);
+    mTailPosition += mHeadBlock;
+    if (mTailPosition == mTailBlock)
+    {
+      mTail.finish();
+      mTail.flip();
+      mTail.push(mPending.data(), mPending.data() + mTailBlock);
+      mTailPosition = 0;
+    }
+    mTail.run(mTailUnitsPerBlock);
+  }
+
+  void Convolver::process()
+  {
+    AUDIT_PROCESS();
+    float *left = mLeftInput.buffer();
+    float *right = mRightInput.buffer();
+    float *leftOut = mLeftOutput.buffer();
+    float *rightOut = mRightOutput.buffer();
+
+    if (!mEnabled)
+    {
+      memset(leftOut, 0, sizeof(float) * FRAMELENGTH);
+      memset(rightOut, 0, sizeof(float) * FRAMELENGTH);
+      return;
+    }
+
+    // frames of any length go through a head block sized buffer
+    int i = 0;
+    while (i < FRAMELENGTH)
+    {
+      int n = MIN(FRAMELENGTH - i, mHeadBlock - mFill);
+      memcpy(mInput.data() + mFill, left + i, sizeof(float) * n);
+      memcpy(mInput.data() + mHeadBlock + mFill, right + i, sizeof(float) * n);
+      memcpy(leftOut + i, mOutput.data() + mFill, sizeof(float) * n);
+      memcpy(rightOut + i, mOutput.data() + mHeadBlock + mFill, sizeof(float) * n);
+      mFill += n;
+      i += n;
+      if (mFill == mHeadBlock)
+      {
+        processBlock();
+        mFill = 0;
+      }
+    }
+  }
+} /* namespace fdelay */
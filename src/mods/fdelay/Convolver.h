@@ -0,0 +1,66 @@
+#pragma once
+
+#include <od/objects/Object.h>
+#include <od/audio/Sample.h>
+#include <ConvolutionStage.h>
+#include <vector>
+
+#define CONVOLVER_TWO_STAGE 1
+#define CONVOLVER_UNIFORM 2
+
+namespace fdelay
+{
+  // Stereo convolution with an impulse response taken from a sample (mono
+  // samples feed both channels). The IR is transformed by setSample() on the
+  // UI thread; the audio thread only multiplies spectra.
+  //
+  // The first 2 * mTailBlock samples of the IR are convolved in blocks of
+  // mHeadBlock every block. The rest uses blocks of mTailBlock whose work is
+  // spread evenly over the head blocks it takes to collect the next one, so
+  // the cost per frame stays flat for IRs of several seconds. In the Uniform
+  // mode the whole IR uses head blocks. Latency is one head block.
+  class Convolver : public od::Object
+  {
+  public:
+    Convolver(float maxSecs = 4.0f);
+    virtual ~Convolver();
+
+    // UI thread, null removes the impulse response
+    bool setSample(od::Sample *sample);
+    float getLength();
+    float getMaxLength();
+
+    static const int mHeadBlock = 128;
+    static const int mTailBlock = 2048;
+
+#ifndef SWIGLUA
+    virtual void process();
+    od::Inlet mLeftInput{"Left In"};
+    od::Inlet mRightInput{"Right In"};
+    od::Outlet mLeftOutput{"Left Out"};
+    od::Outlet mRightOutput{"Right Out"};
+    od::Option mPartitioning{"Partitioning", CONVOLVER_TWO_STAGE};
+#endif
+
+  private:
+    void processBlock();
+
+    ConvolutionStage mHead;
+    ConvolutionStage mTail;
+    int mTailUnitsPerBlock = 0;
+
+    // one head block of input and output, left then right
+    std::vector<float> mInput;
+    std::vector<float> mOutput;
+    int mFill = 0;
+
+    // one tail block of input, left then right
+    std::vector<float> mPending;
+    int mTailPosition = 0;
+
+    float mMaxSeconds = 0.0f;
+    float mLength = 0.0f;
+
+    std::atomic<bool> mEnabled{false};
+  };
+} /* namespace fdelay */
@@ -0,0 +1,183 @@
+#include <Diffuser.h>
+#include <AllocationAudit.h>
+#include <od/config.h>
+#include <hal/simd.h>
+#include <hal/ops.h>
+
+namespace fdelay
+{
+
+  // Stage delays in seconds at size 1. The first four are the input
+  // diffusers of Dattorro's plate, the rest fill the gaps between them.
+  static const float stageTimes[Diffuser::mMaxStages] = {
+      0.00477f, 0.00360f, 0.01273f, 0.00931f,
+      0.00229f, 0.00709f, 0.00563f, 0.00161f};
+  // right channel delays are this much longer
+  static const float rightSpread = 1.087f;
+  static const float maxDiffusion = 0.85f;
+
+  static int gcd(int a, int b)
+  {
+    while (b != 0)
+    {
+      int t = a % b;
+      a = b;
+      b = t;
+    }
+    return a;
+  }
+
+  // smallest n >= x that shares no factor with any of the given delays
+  static int coprime(int x, const int *delays, int count)
+  {
+    for (int n = MAX(2, x);; n++)
+    {
+      int i = 0;
+      while (i < count && gcd(n, delays[i]) == 1)
+      {
+        i++;
+      }
+      if (i == count)
+      {
+        return n;
+      }
+    }
+  }
+
+  Diffuser::Diffuser(int stages, float size)
+  {
+    addInput(mLeftInput);
+    addInput(mRightInput);
+    addOutput(mLeftOutput);
+    addOutput(mRightOutput);
+    addParameter(mDiffusion);
+
+    mStageCount = CLAMP(1, mMaxStages, stages);
+    mWork.resize(2 * globalConfig.frameLength);
+    setSize(size);
+  }
+
+  Diffuser::~Diffuser()
+  {
+  }
+
+  void Diffuser::setSize(float size)
+  {
+    mEnabled = false;
+
+    mSize = CLAMP(0.05f, 4.0f, size);
+    int delays[2 * mMaxStages];
+    int n = 0;
+    int frames = 0;
+    for (int i = 0; i < mStageCount; i++)
+    {
+      Stage &stage = mStages[i];
+      float samples = stageTimes[i] * mSize * globalConfig.sampleRate;
+      stage.leftDelay = coprime(samples, delays, n);
+      delays[n++] = stage.leftDelay;
+      stage.rightDelay = coprime(samples * rightSpread, delays, n);
+      delays[n++] = stage.rightDelay;
+      stage.size = MAX(stage.leftDelay, stage.rightDelay);
+      stage.offset = frames;
+      stage.write = 0;
+      frames += stage.size;
+    }
+    mMemory.assign(2 * frames, 0.0f);
+
+    mEnabled = true;
+  }
+
+  float Diffuser::getSize()
+  {
+    return mSize;
+  }
+
+  int Diffuser::getStageCount()
+  {
+    return mStageCount;
+  }
+
+  void Diffuser::processStage(Stage &stage, float *work, float g)
+  {
+    float *ring = mMemory.data() + 2 * stage.offset;
+    float32x2_t gain = vdup_n_f32(g);
+    float32x2_t d = vdup_n_f32(0.0f);
+    int size = stage.size;
+    int write = stage.write;
+    int left = write - stage.leftDelay;
+    int right = write - stage.rightDelay;
+    if (left < 0)
+    {
+      left += size;
+    }
+    if (right < 0)
+    {
+      right += size;
+    }
+
+    for (int i = 0; i < FRAMELENGTH; i++)
+    {
+      // w[n] = x[n] + g w[n-D], y[n] = w[n-D] - g w[n]
+      d = vld1_lane_f32(ring + 2 * left, d, 0);
+      d = vld1_lane_f32(ring + 2 * right + 1, d, 1);
+      float32x2_t x = vld1_f32(work + 2 * i);
+      float32x2_t w = vmla_f32(x, gain, d);
+      vst1_f32(ring + 2 * write, w);
+      vst1_f32(work + 2 * i, vmls_f32(d, gain, w));
+
+      if (++write == size)
+      {
+        write = 0;
+      }
+      if (++left == size)
+      {
+        left = 0;
+      }
+      if (++right == size)
+      {
+        right = 0;
+      }
+    }
+
+    stage.write = write;
+  }
+
+  void Diffuser::process()
+  {
+    AUDIT_PROCESS();
+    float *inL = mLeftInput.buffer();
+    float *inR = mRightInput.buffer();
+    float *outL = mLeftOutput.buffer();
+    float *outR = mRightOutput.buffer();
+
+    if (!mEnabled)
+    {
+      for (int i = 0; i < FRAMELENGTH; i++)
+      {
+        outL[i] = inL[i];
+        outR[i] = inR[i];
+      }
+      return;
+    }
+
+    float *work = mWork.data();
+    for (int i = 0; i < FRAMELENGTH; i++)
+    {
+      work[2 * i] = inL[i];
+      work[2 * i + 1] = inR[i];
+    }
+
+    float g = CLAMP(0.0f, maxDiffusion, mDiffusion.value());
+    for (int s = 0; s < mStageCount; s++)
+    {
+      processStage(mStages[s], work, g);
+    }
+
+    for (int i = 0; i < FRAMELENGTH; i++)
+    {
+      outL[i] = work[2 * i];
+      outR[i] = work[2 * i + 1];
+    }
+  }
+
+} /* namespace fdelay */
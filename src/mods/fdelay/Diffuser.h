@@ -0,0 +1,59 @@
+#pragma once
+
+#include <od/objects/Object.h>
+#include <atomic>
+#include <vector>
+
+namespace fdelay
+{
+  // Input diffusion for the reverbs: a chain of Schroeder allpasses per
+  // channel with short delays. All delays of both channels are mutually
+  // prime, so the echoes of one stage never line up with those of another.
+  //
+  // Left and right run as the two lanes of one vector. A stage keeps one
+  // interleaved ring for both channels, and the rings of all stages share
+  // one block of memory.
+  class Diffuser : public od::Object
+  {
+  public:
+    Diffuser(int stages = 4, float size = 1.0f);
+    virtual ~Diffuser();
+
+    static const int mMaxStages = 8;
+
+    // Scales all delays, 1 is about 1.6 to 12.7ms per stage. Clears the memory.
+    void setSize(float size);
+    float getSize();
+    int getStageCount();
+
+#ifndef SWIGLUA
+    virtual void process();
+    od::Inlet mLeftInput{"Left In"};
+    od::Inlet mRightInput{"Right In"};
+    od::Outlet mLeftOutput{"Left Out"};
+    od::Outlet mRightOutput{"Right Out"};
+    // allpass coefficient, limited to 0.85
+    od::Parameter mDiffusion{"Diffusion", 0.6f};
+#endif
+
+  private:
+    struct Stage
+    {
+      // offset of the ring in mMemory, in stereo frames
+      int offset;
+      int size;
+      int leftDelay;
+      int rightDelay;
+      int write;
+    };
+
+    void processStage(Stage &stage, float *work, float g);
+
+    Stage mStages[mMaxStages];
+    int mStageCount = 0;
+    float mSize = 0.0f;
+    std::vector<float> mMemory;
+    std::vector<float> mWork;
+    std::atomic<bool> mEnabled{false};
+  };
+} /* namespace fdelay */
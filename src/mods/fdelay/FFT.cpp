@@ -0,0 +1,155 @@
+#include <FFT.h>
+#include <hal/simd.h>
+#include <math.h>
+
+namespace fdelay
+{
+
+  void FFT::setSize(int size)
+  {
+    int bits = 0;
+    while ((1 << bits) < size)
+    {
+      bits++;
+    }
+    mSize = 1 << bits;
+    mPassCount = bits + 1;
+
+    mSwaps.clear();
+    for (int i = 0; i < mSize; i++)
+    {
+      int j = 0;
+      for (int b = 0; b < bits; b++)
+      {
+        j |= ((i >> b) & 1) << (bits - 1 - b);
+      }
+      if (i < j)
+      {
+        mSwaps.push_back(i);
+        mSwaps.push_back(j);
+      }
+    }
+
+    mCos.resize(mSize);
+    mSin.resize(mSize);
+    for (int half = 1; half < mSize; half <<= 1)
+    {
+      for (int j = 0; j < half; j++)
+      {
+        double w = -M_PI * j / half;
+        mCos[half - 1 + j] = cos(w);
+        mSin[half - 1 + j] = sin(w);
+      }
+    }
+  }
+
+  int FFT::getSize()
+  {
+    return mSize;
+  }
+
+  int FFT::getPassCount()
+  {
+    return mPassCount;
+  }
+
+  void FFT::reverse(float *re, float *im)
+  {
+    int n = mSwaps.size();
+    const int *swaps = mSwaps.data();
+    for (int k = 0; k < n; k += 2)
+    {
+      int i = swaps[k];
+      int j = swaps[k + 1];
+      float t = re[i];
+      re[i] = re[j];
+      re[j] = t;
+      t = im[i];
+      im[i] = im[j];
+      im[j] = t;
+    }
+  }
+
+  void FFT::butterflies(float *re, float *im, int half)
+  {
+    const float *wr = mCos.data() + half - 1;
+    const float *wi = mSin.data() + half - 1;
+
+    if (half < 4)
+    {
+      for (int b = 0; b < mSize; b += 2 * half)
+      {
+        for (int j = 0; j < half; j++)
+        {
+          int p = b + j;
+          int q = p + half;
+          float tr = re[q] * wr[j] - im[q] * wi[j];
+          float ti = re[q] * wi[j] + im[q] * wr[j];
+          re[q] = re[p] - tr;
+          im[q] = im[p] - ti;
+          re[p] += tr;
+          im[p] += ti;
+        }
+      }
+      return;
+    }
+
+    for (int b = 0; b < mSize; b += 2 * half)
+    {
+      float *pr = re + b;
+      float *pi = im + b;
+      float *qr = pr + half;
+      float *qi = pi + half;
+      for (int j = 0; j < half; j += 4)
+      {
+        float32x4_t c = vld1q_f32(wr + j);
+        float32x4_t s = vld1q_f32(wi + j);
+        float32x4_t xr = vld1q_f32(qr + j);
+        float32x4_t xi = vld1q_f32(qi + j);
+        float32x4_t tr = vmlsq_f32(vmulq_f32(xr, c), xi, s);
+        float32x4_t ti = vmlaq_f32(vmulq_f32(xr, s), xi, c);
+        float32x4_t ar = vld1q_f32(pr + j);
+        float32x4_t ai = vld1q_f32(pi + j);
+        vst1q_f32(qr + j, vsubq_f32(ar, tr));
+        vst1q_f32(qi + j, vsubq_f32(ai, ti));
+        vst1q_f32(pr + j, vaddq_f32(ar, tr));
+        vst1q_f32(pi + j, vaddq_f32(ai, ti));
+      }
+    }
+  }
+
+  void FFT::forwardPass(float *re, float *im, int pass)
+  {
+    if (pass == 0)
+    {
+      reverse(re, im);
+    }
+    else
+    {
+      butterflies(re, im, 1 << (pass - 1));
+    }
+  }
+
+  void FFT::inversePass(float *re, float *im, int pass)
+  {
+    // the inverse is the forward transform with real and imaginary swapped
+    forwardPass(im, re, pass);
+  }
+
+  void FFT::forward(float *re, float *im)
+  {
+    for (int pass = 0; pass < mPassCount; pass++)
+    {
+      forwardPass(re, im, pass);
+    }
+  }
+
+  void FFT::inverse(float *re, float *im)
+  {
+    for (int pass = 0; pass < mPassCount; pass++)
+    {
+      inversePass(re, im, pass);
+    }
+  }
+
+} /* namespace fdelay */
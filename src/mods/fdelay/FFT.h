@@ -0,0 +1,38 @@
+#pragma once
+
+#include <vector>
+
+namespace fdelay
+{
+
+  // In-place radix-2 complex FFT on split real/imaginary arrays. The
+  // transform is exposed as separate passes (bit reversal, then one pass per
+  // butterfly stage) so a caller can spread a large transform over several
+  // frames. The inverse is unscaled.
+  class FFT
+  {
+  public:
+    // UI thread, size must be a power of two (at least 4)
+    void setSize(int size);
+    int getSize();
+    int getPassCount();
+
+    // audio thread
+    void forward(float *re, float *im);
+    void inverse(float *re, float *im);
+    void forwardPass(float *re, float *im, int pass);
+    void inversePass(float *re, float *im, int pass);
+
+  private:
+    void reverse(float *re, float *im);
+    void butterflies(float *re, float *im, int half);
+
+    int mSize = 0;
+    int mPassCount = 0;
+    std::vector<int> mSwaps;
+    // twiddles of the stage with half size h start at h - 1
+    std::vector<float> mCos;
+    std::vector<float> mSin;
+  };
+
+} /* namespace fdelay */
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stdint.h>
+
+namespace fdelay
+{
+
+  // xorshift32, good enough for grain scheduling and a lot cheaper than rand().
+  class FastRandom
+  {
+  public:
+    FastRandom(uint32_t seed = 0x9E3779B9) : mState(seed ? seed : 1)
+    {
+    }
+
+    inline uint32_t next()
+    {
+      mState ^= mState << 13;
+      mState ^= mState >> 17;
+      mState ^= mState << 5;
+      return mState;
+    }
+
+    // [0, 1)
+    inline float uniform()
+    {
+      return (next() >> 8) * (1.0f / 16777216.0f);
+    }
+
+    // [-1, 1)
+    inline float bipolar()
+    {
+      return 2.0f * uniform() - 1.0f;
+    }
+
+  private:
+    uint32_t mState;
+  };
+
+} /* namespace fdelay */
@@ -0,0 +1,91 @@
+#include <FeedbackMatrix.h>
+#include <AllocationAudit.h>
+#include <od/config.h>
+#include <hal/simd.h>
+#include <hal/ops.h>
+#include <math.h>
+
+namespace fdelay
+{
+  FeedbackMatrix::FeedbackMatrix()
+  {
+    addInput(mInput1);
+    addInput(mInput2);
+    addInput(mInput3);
+    addInput(mInput4);
+    addOutput(mOutput1);
+    addOutput(mOutput2);
+    addOutput(mOutput3);
+    addOutput(mOutput4);
+    addParameter(mGain);
+  }
+
+  FeedbackMatrix::~FeedbackMatrix()
+  {
+  }
+
+  void FeedbackMatrix::setClampInDecibels(float dB)
+  {
+    mClamp = powf(10.0f, dB * 0.05f);
+  }
+
+  void FeedbackMatrix::process()
+  {
+    AUDIT_PROCESS();
+    float *in1 = mInput1.buffer();
+    float *in2 = mInput2.buffer();
+    float *in3 = mInput3.buffer();
+    float *in4 = mInput4.buffer();
+    float *out1 = mOutput1.buffer();
+    float *out2 = mOutput2.buffer();
+    float *out3 = mOutput3.buffer();
+    float *out4 = mOutput4.buffer();
+
+    float gain = mGain.value();
+    if (fabsf(gain) < mClamp)
+    {
+      gain = 0.0f;
+    }
+
+    // ramp the gain over the frame to avoid zipper noise
+    float step = (gain - mPreviousGain) / FRAMELENGTH;
+    float32x4_t g = {mPreviousGain + step, mPreviousGain + 2 * step,
+                     mPreviousGain + 3 * step, mPreviousGain + 4 * step};
+    float32x4_t dg = vdupq_n_f32(4 * step);
+    mPreviousGain = gain;
+
+    int i = 0;
+    for (; i + 4 <= FRAMELENGTH; i += 4)
+    {
+      float32x4_t x1 = vld1q_f32(in1 + i);
+      float32x4_t x2 = vld1q_f32(in2 + i);
+      float32x4_t x3 = vld1q_f32(in3 + i);
+      float32x4_t x4 = vld1q_f32(in4 + i);
+
+      float32x4_t dif12 = vsubq_f32(x1, x2);
+      float32x4_t sum12 = vaddq_f32(x1, x2);
+      float32x4_t dif34 = vsubq_f32(x3, x4);
+      float32x4_t sum34 = vaddq_f32(x3, x4);
+
+      vst1q_f32(out1 + i, vmulq_f32(g, vsubq_f32(dif12, dif34)));
+      vst1q_f32(out2 + i, vmulq_f32(g, vaddq_f32(dif12, dif34)));
+      vst1q_f32(out3 + i, vmulq_f32(g, vsubq_f32(sum12, sum34)));
+      vst1q_f32(out4 + i, vmulq_f32(g, vaddq_f32(sum12, sum34)));
+
+      g = vaddq_f32(g, dg);
+    }
+
+    // frame lengths that are not a multiple of 4
+    for (float gi = vgetq_lane_f32(g, 0); i < FRAMELENGTH; i++, gi += step)
+    {
+      float dif12 = in1[i] - in2[i];
+      float sum12 = in1[i] + in2[i];
+      float dif34 = in3[i] - in4[i];
+      float sum34 = in3[i] + in4[i];
+      out1[i] = gi * (dif12 - dif34);
+      out2[i] = gi * (dif12 + dif34);
+      out3[i] = gi * (sum12 - sum34);
+      out4[i] = gi * (sum12 + sum34);
+    }
+  }
+} /* namespace fdelay */
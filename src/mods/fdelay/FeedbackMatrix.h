@@ -0,0 +1,41 @@
+#pragma once
+
+#include <od/objects/Object.h>
+
+namespace fdelay
+{
+  // The 4x4 Hadamard feedback matrix of the FDN reverbs followed by the
+  // feedback gain, in one object. Replaces eight Sum objects with their
+  // eight polarity ConstantGains and the four feedback ConstantGains.
+  //
+  //   Out1 = g * ((In1 - In2) - (In3 - In4))
+  //   Out2 = g * ((In1 - In2) + (In3 - In4))
+  //   Out3 = g * ((In1 + In2) - (In3 + In4))
+  //   Out4 = g * ((In1 + In2) + (In3 + In4))
+  class FeedbackMatrix : public od::Object
+  {
+  public:
+    FeedbackMatrix();
+    virtual ~FeedbackMatrix();
+
+    // Gains below this level are treated as zero, like ConstantGain.
+    void setClampInDecibels(float dB);
+
+#ifndef SWIGLUA
+    virtual void process();
+    od::Inlet mInput1{"In1"};
+    od::Inlet mInput2{"In2"};
+    od::Inlet mInput3{"In3"};
+    od::Inlet mInput4{"In4"};
+    od::Outlet mOutput1{"Out1"};
+    od::Outlet mOutput2{"Out2"};
+    od::Outlet mOutput3{"Out3"};
+    od::Outlet mOutput4{"Out4"};
+    od::Parameter mGain{"Gain"};
+#endif
+
+  private:
+    float mClamp = 0.0f;
+    float mPreviousGain = 0.0f;
+  };
+} /* namespace fdelay */
@@ -0,0 +1,155 @@
+#include <FreezeBanks.h>
+#include <od/config.h>
+#include <hal/ops.h>
+#include <string.h>
+
+namespace fdelay
+{
+
+  // Samples copied into a bank per frame. Must be at least a frame so the
+  // copy stays ahead of the samples being overwritten.
+  static const int sliceSize = 4096;
+
+  FreezeBanks::FreezeBanks()
+  {
+    for (int i = 0; i < mMaxBanks; i++)
+    {
+      mPending[i] = 0;
+      mRetired[i] = 0;
+    }
+  }
+
+  FreezeBanks::~FreezeBanks()
+  {
+    deallocate();
+  }
+
+  int FreezeBanks::allocate(int banks, int sampleCount)
+  {
+    deallocate();
+    mBankCount = CLAMP(0, mMaxBanks, banks);
+    mSampleCount = sampleCount;
+    return mBankCount;
+  }
+
+  static void releaseSample(od::Sample *sample)
+  {
+    // grains still reading a bank hold their own reference
+    if (sample)
+    {
+      sample->release();
+    }
+  }
+
+  void FreezeBanks::deallocate()
+  {
+    mReady = 0;
+    mRequests = 0;
+    mCapturing = -1;
+    for (int i = 0; i < mBankCount; i++)
+    {
+      releaseSample(mBanks[i]);
+      releaseSample(mPending[i].exchange(0));
+      releaseSample(mRetired[i].exchange(0));
+      mBanks[i] = 0;
+    }
+    mBankCount = 0;
+  }
+
+  int FreezeBanks::getBankCount()
+  {
+    return mBankCount;
+  }
+
+  void FreezeBanks::collect()
+  {
+    for (int i = 0; i < mBankCount; i++)
+    {
+      releaseSample(mRetired[i].exchange(0));
+    }
+  }
+
+  bool FreezeBanks::capture(int bank)
+  {
+    if (bank < 1 || bank > mBankCount)
+    {
+      return false;
+    }
+    collect();
+    int i = bank - 1;
+    if (mPending[i] != 0)
+    {
+      return false;
+    }
+
+    od::Sample *sample = new od::Sample();
+    sample->attach();
+    if (!sample->allocateBuffer(1, mSampleCount))
+    {
+      sample->release();
+      return false;
+    }
+    memset(sample->mpData, 0, sizeof(float) * mSampleCount);
+    mPending[i] = sample;
+    mRequests |= 1u << i;
+    return true;
+  }
+
+  bool FreezeBanks::isReady(int bank)
+  {
+    return bank >= 1 && bank <= mBankCount && (mReady & (1u << (bank - 1)));
+  }
+
+  od::Sample *FreezeBanks::getSample(int bank)
+  {
+    if (isReady(bank))
+    {
+      return mBanks[bank - 1];
+    }
+    return 0;
+  }
+
+  int FreezeBanks::getLength()
+  {
+    // the frame before the oldest sample is overwritten while a capture
+    // runs, so it is left out
+    return mSampleCount - FRAMELENGTH;
+  }
+
+  void FreezeBanks::update(od::Sample *live, int oldest)
+  {
+    if (mCapturing < 0)
+    {
+      uint32_t requests = mRequests;
+      if (requests == 0)
+      {
+        return;
+      }
+      mCapturing = __builtin_ctz(requests);
+      mRequests &= ~(1u << mCapturing);
+      mSource = oldest;
+      mCopied = 0;
+    }
+
+    od::Sample *bank = mPending[mCapturing];
+    int count = MIN(mSampleCount, (int)live->mSampleCount);
+    int length = count - FRAMELENGTH;
+    int n = MIN(MAX(sliceSize, FRAMELENGTH), length - mCopied);
+    int from = (mSource + mCopied) % count;
+    int m = MIN(n, count - from);
+    memcpy(bank->mpData + mCopied, live->mpData + from, sizeof(float) * m);
+    memcpy(bank->mpData + mCopied + m, live->mpData, sizeof(float) * (n - m));
+    mCopied += n;
+
+    if (mCopied == length)
+    {
+      // capture() released the previous retired bank before requesting this
+      mRetired[mCapturing] = mBanks[mCapturing];
+      mBanks[mCapturing] = bank;
+      mPending[mCapturing] = 0;
+      mReady |= 1u << mCapturing;
+      mCapturing = -1;
+    }
+  }
+
+} /* namespace fdelay */
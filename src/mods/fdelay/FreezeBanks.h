@@ -0,0 +1,63 @@
+#pragma once
+
+#include <od/audio/Sample.h>
+#include <atomic>
+#include <stdint.h>
+
+namespace fdelay
+{
+
+  // Snapshots of a mono delay history that grains read instead of the live
+  // buffer. A capture copies the history as it was when requested, one slice
+  // per frame running ahead of the write head, so no single frame pays for
+  // the whole copy. Banks are stored oldest sample first.
+  //
+  // A bank takes no memory until it is first captured. Every capture fills a
+  // fresh Sample and swaps it in once complete, so grains still playing the
+  // previous capture keep reading it unchanged and switching bank only
+  // changes which Sample the next grain reads.
+  class FreezeBanks
+  {
+  public:
+    FreezeBanks();
+    ~FreezeBanks();
+
+    static const int mMaxBanks = 8;
+
+    // UI thread, banks are numbered from 1
+    int allocate(int banks, int sampleCount);
+    void deallocate();
+    int getBankCount();
+    // false while the bank is still capturing or out of memory
+    bool capture(int bank);
+    bool isReady(int bank);
+
+    // audio thread, call before the live history is pushed
+    void update(od::Sample *live, int oldest);
+    // null unless the bank holds a completed capture
+    od::Sample *getSample(int bank);
+    // samples at the start of a bank that hold the capture
+    int getLength();
+
+  private:
+    void collect();
+
+    // audio thread
+    od::Sample *mBanks[mMaxBanks] = {};
+    // set by the UI thread for a capture, swapped into mBanks when complete
+    std::atomic<od::Sample *> mPending[mMaxBanks];
+    // replaced by a swap, released by the UI thread
+    std::atomic<od::Sample *> mRetired[mMaxBanks];
+    int mBankCount = 0;
+    int mSampleCount = 0;
+
+    // bit per bank
+    std::atomic<uint32_t> mRequests{0};
+    std::atomic<uint32_t> mReady{0};
+
+    int mCapturing = -1;
+    int mSource = 0;
+    int mCopied = 0;
+  };
+
+} /* namespace fdelay */
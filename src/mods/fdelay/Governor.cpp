@@ -0,0 +1,102 @@
+#include <Governor.h>
+#include <Ticks.h>
+#include <od/config.h>
+#include <hal/ops.h>
+
+namespace fdelay
+{
+
+  // Frames to wait after a level change before escalating again, so the
+  // previous step has a chance to show in the measurement.
+  static const int settleFrames = 8;
+  // Seconds the load must stay under the recovery threshold before stepping back.
+  static const float recoverTime = 0.5f;
+  static const float recoverThreshold = 0.6f;
+  static const float smoothing = 0.1f;
+
+  Governor::Governor()
+  {
+  }
+
+  void Governor::checkClock()
+  {
+    mAvailable = common::ticksRunning();
+    if (!mAvailable)
+    {
+      reset();
+    }
+  }
+
+  bool Governor::isAvailable()
+  {
+    return mAvailable;
+  }
+
+  void Governor::setBudget(float fraction)
+  {
+    mBudget = CLAMP(0.01f, 1.0f, fraction);
+  }
+
+  float Governor::getBudget()
+  {
+    return mBudget;
+  }
+
+  int Governor::getLevel()
+  {
+    return mLevel;
+  }
+
+  float Governor::getLoad()
+  {
+    return mLoad;
+  }
+
+  void Governor::reset()
+  {
+    mLoad = 0.0f;
+    mLevel = mLevelNormal;
+    mFramesSinceChange = 0;
+    mFramesUnderBudget = 0;
+  }
+
+  void Governor::begin()
+  {
+    mStart = common::ticks();
+  }
+
+  void Governor::end()
+  {
+    uint32_t elapsed = common::ticks() - mStart;
+    float framePeriod = globalConfig.frameLength * globalConfig.samplePeriod;
+    float load = elapsed / (common::ticksPerSecond * framePeriod);
+    mLoad += smoothing * (load - mLoad);
+    mFramesSinceChange++;
+
+    if (mLoad > mBudget)
+    {
+      mFramesUnderBudget = 0;
+      if (mLevel < mLevelMax && mFramesSinceChange >= settleFrames)
+      {
+        mLevel++;
+        mFramesSinceChange = 0;
+      }
+    }
+    else if (mLoad < recoverThreshold * mBudget)
+    {
+      mFramesUnderBudget++;
+      if (mLevel > mLevelNormal &&
+          mFramesUnderBudget * framePeriod > recoverTime)
+      {
+        mLevel--;
+        mFramesSinceChange = 0;
+        mFramesUnderBudget = 0;
+      }
+    }
+    else
+    {
+      mFramesUnderBudget = 0;
+    }
+  }
+
+} /* namespace fdelay */
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <stdint.h>
+
+namespace fdelay
+{
+
+  // Tracks the time an object spends in process() against a budget expressed
+  // as a fraction of the frame period and derives a degradation level from it.
+  // The level rises quickly when over budget and falls back slowly once the
+  // load has stayed well below budget for a while.
+  class Governor
+  {
+  public:
+    Governor();
+
+    // degradation levels
+    static const int mLevelNormal = 0;
+    static const int mLevelLowOrder = 1;
+    static const int mLevelShortGrains = 2;
+    static const int mLevelCapGrains = 3;
+    static const int mLevelMax = mLevelCapGrains;
+
+    // Checks that the tick source runs. Without it the load can not be
+    // measured, and the governor stays at the normal level.
+    void checkClock();
+    bool isAvailable();
+
+    void setBudget(float fraction);
+    float getBudget();
+    int getLevel();
+    float getLoad();
+    void reset();
+
+    void begin();
+    void end();
+
+  private:
+    bool mAvailable = true;
+    uint32_t mStart = 0;
+    float mBudget = 0.15f;
+    float mLoad = 0.0f;
+    int mLevel = mLevelNormal;
+    int mFramesSinceChange = 0;
+    int mFramesUnderBudget = 0;
+  };
+
+} /* namespace fdelay */
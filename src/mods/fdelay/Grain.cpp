@@ -130,7 +130,8 @@ namespace fdelay
   {
     float phase[4] = {0.0f, 0.0f, 0.0f, 0.0f};
 
-    for (int i = 0; i < n; i += 4)
+    int i = 0;
+    for (; i + 4 <= n; i += 4)
     {
       mEnvelopePhase += mEnvelopePhaseDelta;
       phase[0] = mEnvelopePhase;
@@ -143,13 +144,33 @@ namespace fdelay
 
       vst1q_f32(out + i, simd_sine_env(phase));
     }
+
+    if (i < n)
+    {
+      // frame lengths that are not a multiple of 4
+      float tail[4];
+      for (int k = 0; k < 4; k++)
+      {
+        if (i + k < n)
+        {
+          mEnvelopePhase += mEnvelopePhaseDelta;
+        }
+        phase[k] = mEnvelopePhase;
+      }
+      vst1q_f32(tail, simd_sine_env(phase));
+      for (int k = 0; i < n; i++, k++)
+      {
+        out[i] = tail[k];
+      }
+    }
   }
 
   void Grain::generateHanningWindow(float *out, int n)
   {
     float phase[4] = {0.0f, 0.0f, 0.0f, 0.0f};
 
-    for (int i = 0; i < n; i += 4)
+    int i = 0;
+    for (; i + 4 <= n; i += 4)
     {
       mEnvelopePhase += mEnvelopePhaseDelta;
       phase[0] = mEnvelopePhase;
@@ -162,6 +183,25 @@ namespace fdelay
 
       vst1q_f32(out + i, simd_hanning(phase));
     }
+
+    if (i < n)
+    {
+      // frame lengths that are not a multiple of 4
+      float tail[4];
+      for (int k = 0; k < 4; k++)
+      {
+        if (i + k < n)
+        {
+          mEnvelopePhase += mEnvelopePhaseDelta;
+        }
+        phase[k] = mEnvelopePhase;
+      }
+      vst1q_f32(tail, simd_hanning(phase));
+      for (int k = 0; i < n; i++, k++)
+      {
+        out[i] = tail[k];
+      }
+    }
   }
 
   void Grain::generateTrapezoidWindow(float *out, int n)
@@ -223,7 +263,8 @@ namespace fdelay
     float32x4_t min = vdupq_n_f32(-1.5);
     float32x4_t g = vdupq_n_f32(mSquash);
 
-    for (int i = 0; i < n; i += 4)
+    int i = 0;
+    for (; i + 4 <= n; i += 4)
     {
       x = g * vld1q_f32(out + i);
       x = vminq_f32(x, max);
@@ -231,6 +272,13 @@ namespace fdelay
       x3 = vmulq_f32(x, vmulq_f32(x, x));
       vst1q_f32(out + i, vmlaq_f32(x, c, x3));
     }
+
+    // frame lengths that are not a multiple of 4
+    for (; i < n; i++)
+    {
+      float y = CLAMP(-1.5f, 1.5f, mSquash * out[i]);
+      out[i] = y - y * y * y / 6.75f;
+    }
   }
 
     void Grain::setEnvelope(int type)
@@ -239,6 +287,11 @@ namespace fdelay
       mFade = 0;
     }
 
+    void Grain::setInterpolation(int order)
+    {
+      mInterpolation = order;
+    }
+
     void Grain::setFade(int fade)
     {
       mFade = fade;
@@ -251,11 +304,9 @@ namespace fdelay
 
     void Grain::setDelay(int samples)
     {
-      // Positive delays only up to duration of grain.
+      // Positive delays only up to duration of grain. The kernels start
+      // their 4-sample blocks at the delay, so any offset is exact.
       mDelayInSamples = CLAMP(0, mDuration, samples);
-      // Enforce NEON alignment
-      mDelayInSamples /= 4;
-      mDelayInSamples *= 4;
     }
 
     int Grain::samplesRequired()
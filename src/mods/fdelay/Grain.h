@@ -23,7 +23,12 @@ namespace fdelay
     static const int mHanningWindow = 1;
     static const int mTrapezoidWindow = 2;
 
+    // interpolation orders
+    static const int mLinearInterpolation = 1;
+    static const int mQuadraticInterpolation = 2;
+
     void setEnvelope(int type);
+    void setInterpolation(int order);
     void setFade(int fade);
     void setSquash(float squash);
     void setDelay(int samples);
@@ -38,6 +43,7 @@ namespace fdelay
     float mEnvelopePhase = 0.0f;
     float mEnvelopePhaseDelta = 0.0f;
     int mEnvelopeType = mSineWindow;
+    int mInterpolation = mQuadraticInterpolation;
     int mFade = 0; // in samples
     int mCurrentIndex = 0;
     int mDuration = 0;
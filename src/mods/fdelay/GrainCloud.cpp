@@ -0,0 +1,224 @@
+#include <GrainCloud.h>
+#include <AllocationAudit.h>
+#include <Trace.h>
+#include <od/config.h>
+#include <hal/ops.h>
+#include <algorithm>
+#include <math.h>
+#include <string.h>
+
+namespace fdelay
+{
+  GrainCloud::GrainCloud(float secs, int grainCount)
+  {
+    addInput(mInput);
+    addInput(mSpeed);
+    addParameter(mDensity);
+    addParameter(mJitter);
+    addParameter(mDelay);
+    addParameter(mSpray);
+    addParameter(mDuration);
+    addParameter(mPitchSpread);
+    addParameter(mPanSpread);
+    addParameter(mSquash);
+    addOutput(mLeftOutput);
+    addOutput(mRightOutput);
+
+    setMaximumGrainCount(CLAMP(1, mMaxGrainCount, grainCount));
+    setMaxDelay(secs);
+  }
+
+  GrainCloud::~GrainCloud()
+  {
+  }
+
+  int GrainCloud::getGrainCount()
+  {
+    return mGainCompensation.size();
+  }
+
+  Grain *GrainCloud::getGrain(int index)
+  {
+    if (index < 0 || index >= (int)mGainCompensation.size())
+    {
+      return NULL;
+    }
+
+    return static_cast<Grain *>(&mGrains[index]);
+  }
+
+  void GrainCloud::stopAllGrains()
+  {
+    mFreeGrains.clear();
+    for (MonoGrain &grain : mGrains)
+    {
+      if (grain.mActive)
+      {
+        grain.stop();
+      }
+      mFreeGrains.push_back(&grain);
+    }
+  }
+
+  float GrainCloud::getMaxDelay()
+  {
+    return mMaxDelayInSeconds;
+  }
+
+  float GrainCloud::setMaxDelay(float secs)
+  {
+    mEnabled = false;
+    stopAllGrains();
+
+    if (secs < 0.0f)
+    {
+      secs = 0.0f;
+    }
+    mMaxDelayInSeconds = secs;
+    mMaxDelayInSamples = (int)(secs * globalConfig.sampleRate);
+    mSampleFifo.setSampleRate(globalConfig.sampleRate);
+    mSampleFifo.allocateBuffer(1, mMaxDelayInSamples + 2 * globalConfig.frameLength);
+    mSampleFifo.zeroAndFill();
+
+    for (MonoGrain &grain : mGrains)
+    {
+      grain.setSample(mSampleFifo.getSample());
+    }
+
+    mCountdown = 0.0f;
+    mEnabled = true;
+    return mMaxDelayInSeconds;
+  }
+
+  void GrainCloud::setMaximumGrainCount(int n)
+  {
+    mFreeGrains.clear();
+    mFreeGrains.reserve(n);
+    mActiveGrains.clear();
+    mActiveGrains.reserve(n);
+    mGrains.resize(n);
+    // push grains in a reverse memory order for better cache perf
+    for (auto i = mGrains.rbegin(); i != mGrains.rend(); i++)
+    {
+      MonoGrain &grain = *i;
+      mFreeGrains.push_back(&grain);
+    }
+
+    mGainCompensation.resize(n);
+    for (int i = 0; i < n; i++)
+    {
+      mGainCompensation[i] = 1.0f / sqrtf(n - i);
+    }
+  }
+
+  MonoGrain *GrainCloud::getNextFreeGrain()
+  {
+    if (mEnabled && mFreeGrains.size() > 0)
+    {
+      MonoGrain *grain = mFreeGrains.back();
+      mFreeGrains.pop_back();
+      return grain;
+    }
+    else
+    {
+      return 0;
+    }
+  }
+
+  void GrainCloud::startGrain(int offset, float speed)
+  {
+    MonoGrain *grain = getNextFreeGrain();
+    if (grain == 0)
+    {
+      TRACE(common::TRACE_GRAIN_DROP, 0, speed, 0.0f);
+      return;
+    }
+
+    float pitchSpread = mPitchSpread.value();
+    if (pitchSpread > 0.0f)
+    {
+      // spread is in semitones
+      speed *= exp2f(pitchSpread * mRandom.bipolar() * (1.0f / 12.0f));
+    }
+
+    float duration = MIN(mDuration.value(), mMaxDelayInSeconds - 0.01f);
+    float delay = mDelay.value() + mSpray.value() * mRandom.uniform();
+    int durationSamples = duration * globalConfig.sampleRate;
+    int delaySamples = delay * globalConfig.sampleRate;
+
+    // Keep forward grains behind the write head and reverse grains inside the buffer.
+    float reach = speed * durationSamples;
+    int minDelay = MAX(0, (int)(reach - durationSamples));
+    int maxDelay = mMaxDelayInSamples - MAX(0, (int)(-reach));
+    delaySamples = CLAMP(minDelay, maxDelay, delaySamples);
+    delaySamples = CLAMP(0, mMaxDelayInSamples, delaySamples);
+
+    int start = mMaxDelayInSamples - delaySamples + offset;
+    start += mSampleFifo.offsetToRecent(mMaxDelayInSamples + globalConfig.frameLength);
+
+    float pan = CLAMP(-1.0f, 1.0f, mPanSpread.value() * mRandom.bipolar());
+    float gain = mGainCompensation[mFreeGrains.size()];
+    grain->init(start, durationSamples, speed, gain, pan);
+    grain->setDelay(offset);
+    grain->setSquash(mSquash.value());
+    TRACE(common::TRACE_GRAIN_START, grain - &mGrains[0], speed, durationSamples);
+  }
+
+  void GrainCloud::process()
+  {
+    AUDIT_PROCESS();
+    if (!mEnabled)
+    {
+      return;
+    }
+    float *in = mInput.buffer();
+    float *speed = mSpeed.buffer();
+    float *left = mLeftOutput.buffer();
+    float *right = mRightOutput.buffer();
+
+    mSampleFifo.pop(FRAMELENGTH);
+    mSampleFifo.pushMono(in, FRAMELENGTH);
+
+    memset(left, 0, sizeof(float) * FRAMELENGTH);
+    memset(right, 0, sizeof(float) * FRAMELENGTH);
+
+    float density = mDensity.value();
+    if (density > 0.0f)
+    {
+      float interval = globalConfig.sampleRate / density;
+      float jitter = CLAMP(0.0f, 1.0f, mJitter.value());
+      while (mCountdown < FRAMELENGTH)
+      {
+        startGrain((int)mCountdown, speed[(int)mCountdown]);
+        mCountdown += MAX(1.0f, interval * (1.0f + jitter * mRandom.bipolar()));
+      }
+      mCountdown -= FRAMELENGTH;
+    }
+    else
+    {
+      mCountdown = 0.0f;
+    }
+
+    mActiveGrains.clear();
+    for (MonoGrain &grain : mGrains)
+    {
+      if (grain.mActive)
+      {
+        mActiveGrains.push_back(&grain);
+      }
+    }
+
+    // sort by sample position for cache coherence
+    std::sort(mActiveGrains.begin(), mActiveGrains.end());
+
+    for (MonoGrain *grain : mActiveGrains)
+    {
+      grain->synthesizeFromMonoToStereo(left, right);
+      if (!grain->mActive)
+      {
+        TRACE(common::TRACE_GRAIN_STOP, grain - &mGrains[0], 0.0f, 0.0f);
+        mFreeGrains.push_back(grain);
+      }
+    }
+  }
+} /* namespace fdelay */
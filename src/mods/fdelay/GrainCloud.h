@@ -0,0 +1,68 @@
+#pragma once
+
+#include <od/objects/Object.h>
+#include <od/audio/SampleFifo.h>
+#include <MonoGrain.h>
+#include <FastRandom.h>
+#include <vector>
+
+namespace fdelay
+{
+  // Grain delay with its own scheduler. Grains are started at sample offsets
+  // inside the frame at the rate set by Density, so no external trigger is
+  // needed and several grains can start in the same frame.
+  class GrainCloud : public od::Object
+  {
+  public:
+    GrainCloud(float secs, int grainCount = 32);
+    virtual ~GrainCloud();
+
+    float setMaxDelay(float secs);
+    float getMaxDelay();
+
+    static const int mMaxGrainCount = 64;
+
+#ifndef SWIGLUA
+    virtual void process();
+    od::Inlet mInput{"In"};
+    od::Inlet mSpeed{"Speed"};
+    od::Parameter mDensity{"Density", 10.0f};
+    od::Parameter mJitter{"Jitter"};
+    od::Parameter mDelay{"Delay"};
+    od::Parameter mSpray{"Spray"};
+    od::Parameter mDuration{"Duration", 0.1f};
+    od::Parameter mPitchSpread{"Pitch Spread"};
+    od::Parameter mPanSpread{"Pan Spread"};
+    od::Parameter mSquash{"Squash"};
+    od::Outlet mLeftOutput{"Left Out"};
+    od::Outlet mRightOutput{"Right Out"};
+
+    int getGrainCount();
+    Grain *getGrain(int index);
+#endif
+
+  private:
+    od::SampleFifo mSampleFifo;
+
+    std::vector<MonoGrain> mGrains;
+    std::vector<MonoGrain *> mFreeGrains;
+    std::vector<MonoGrain *> mActiveGrains;
+
+    // gain compensation (indexed by number of free grains)
+    std::vector<float> mGainCompensation;
+
+    MonoGrain *getNextFreeGrain();
+    void setMaximumGrainCount(int n);
+    void stopAllGrains();
+    void startGrain(int offset, float speed);
+
+    FastRandom mRandom;
+    // samples until the next scheduled grain, relative to the frame start
+    float mCountdown = 0.0f;
+
+    float mMaxDelayInSeconds = 0.0f;
+    int mMaxDelayInSamples = 0;
+
+    std::atomic<bool> mEnabled{false};
+  };
+} /* namespace fdelay */
@@ -0,0 +1,78 @@
+#include <LazyDelay.h>
+#include <AllocationAudit.h>
+#include <od/config.h>
+#include <hal/ops.h>
+#include <string.h>
+
+namespace fdelay
+{
+  LazyDelay::LazyDelay(float maxSecs, float initialSecs)
+  {
+    addInput(mInput);
+    addInput(mDelay);
+    addOutput(mOutput);
+
+    mLine.allocate(maxSecs, initialSecs);
+    mEnabled = true;
+  }
+
+  LazyDelay::~LazyDelay()
+  {
+  }
+
+  void LazyDelay::reserve(float secs)
+  {
+    mLine.reserve(secs);
+  }
+
+  void LazyDelay::maintain()
+  {
+    mLine.maintain();
+  }
+
+  void LazyDelay::deallocate()
+  {
+    mEnabled = false;
+    mLine.deallocate();
+  }
+
+  float LazyDelay::getAllocatedSeconds()
+  {
+    return mLine.getAllocatedSeconds();
+  }
+
+  float LazyDelay::getMaxDelay()
+  {
+    return mLine.getMaxSeconds();
+  }
+
+  void LazyDelay::process()
+  {
+    AUDIT_PROCESS();
+    float *in = mInput.buffer();
+    float *delay = mDelay.buffer();
+    float *out = mOutput.buffer();
+
+    if (!mEnabled)
+    {
+      memset(out, 0, sizeof(float) * FRAMELENGTH);
+      return;
+    }
+
+    float maxDelay = 0.0f;
+    for (int i = 0; i < FRAMELENGTH; i++)
+    {
+      maxDelay = MAX(maxDelay, delay[i]);
+    }
+    mLine.require(maxDelay * globalConfig.sampleRate);
+
+    int start = mLine.getWriteIndex();
+    mLine.write(in, FRAMELENGTH);
+
+    for (int i = 0; i < FRAMELENGTH; i++)
+    {
+      float d = mLine.clampDelay(delay[i] * globalConfig.sampleRate);
+      out[i] = mLine.read(start + i, d);
+    }
+  }
+} /* namespace fdelay */
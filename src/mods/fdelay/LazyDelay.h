@@ -0,0 +1,33 @@
+#pragma once
+
+#include <od/objects/Object.h>
+#include <ChunkedDelayLine.h>
+
+namespace fdelay
+{
+  // Mono modulated delay (like core's DopplerDelay) whose memory follows the
+  // delay that is actually used instead of the maximum delay.
+  class LazyDelay : public od::Object
+  {
+  public:
+    LazyDelay(float maxSecs, float initialSecs = 1.0f);
+    virtual ~LazyDelay();
+
+    void reserve(float secs);
+    void maintain();
+    void deallocate();
+    float getAllocatedSeconds();
+    float getMaxDelay();
+
+#ifndef SWIGLUA
+    virtual void process();
+    od::Inlet mInput{"In"};
+    od::Inlet mDelay{"Delay"};
+    od::Outlet mOutput{"Out"};
+#endif
+
+  private:
+    ChunkedDelayLine mLine;
+    std::atomic<bool> mEnabled{false};
+  };
+} /* namespace fdelay */
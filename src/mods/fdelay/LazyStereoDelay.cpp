@@ -0,0 +1,89 @@
+#include <LazyStereoDelay.h>
+#include <AllocationAudit.h>
+#include <od/config.h>
+#include <hal/ops.h>
+#include <string.h>
+
+namespace fdelay
+{
+  LazyStereoDelay::LazyStereoDelay(float maxSecs, float initialSecs)
+  {
+    addInput(mLeftInput);
+    addInput(mRightInput);
+    addOutput(mLeftOutput);
+    addOutput(mRightOutput);
+    addParameter(mLeftDelay);
+    addParameter(mRightDelay);
+
+    mLeftLine.allocate(maxSecs, initialSecs);
+    mRightLine.allocate(maxSecs, initialSecs);
+    mEnabled = true;
+  }
+
+  LazyStereoDelay::~LazyStereoDelay()
+  {
+  }
+
+  void LazyStereoDelay::reserve(float secs)
+  {
+    mLeftLine.reserve(secs);
+    mRightLine.reserve(secs);
+  }
+
+  void LazyStereoDelay::maintain()
+  {
+    mLeftLine.maintain();
+    mRightLine.maintain();
+  }
+
+  void LazyStereoDelay::deallocate()
+  {
+    mEnabled = false;
+    mLeftLine.deallocate();
+    mRightLine.deallocate();
+  }
+
+  float LazyStereoDelay::getAllocatedSeconds()
+  {
+    return mLeftLine.getAllocatedSeconds() + mRightLine.getAllocatedSeconds();
+  }
+
+  float LazyStereoDelay::getMaxDelay()
+  {
+    return mLeftLine.getMaxSeconds();
+  }
+
+  void LazyStereoDelay::processChannel(ChunkedDelayLine &line, float *in, float *out, float delay)
+  {
+    delay *= globalConfig.sampleRate;
+    line.require(delay);
+
+    int start = line.getWriteIndex();
+    line.write(in, FRAMELENGTH);
+
+    delay = line.clampDelay(delay);
+    for (int i = 0; i < FRAMELENGTH; i++)
+    {
+      out[i] = line.read(start + i, delay);
+    }
+  }
+
+  void LazyStereoDelay::process()
+  {
+    AUDIT_PROCESS();
+    float *leftIn = mLeftInput.buffer();
+    float *rightIn = mRightInput.buffer();
+    float *leftOut = mLeftOutput.buffer();
+    float *rightOut = mRightOutput.buffer();
+
+    if (!mEnabled)
+    {
+      memset(leftOut, 0, sizeof(float) * FRAMELENGTH);
+      memset(rightOut, 0, sizeof(float) * FRAMELENGTH);
+      return;
+    }
+
+    processChannel(mLeftLine, leftIn, leftOut, mLeftDelay.value());
+    processChannel(mRightLine, rightIn, rightOut, mRightDelay.value());
+  }
+} /* namespace fdelay */
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <od/objects/Object.h>
+#include <ChunkedDelayLine.h>
+
+namespace fdelay
+{
+  // Stereo delay with a delay parameter per channel (like core's Delay(2))
+  // whose memory follows the delay that is actually used.
+  class LazyStereoDelay : public od::Object
+  {
+  public:
+    LazyStereoDelay(float maxSecs, float initialSecs = 1.0f);
+    virtual ~LazyStereoDelay();
+
+    void reserve(float secs);
+    void maintain();
+    void deallocate();
+    float getAllocatedSeconds();
+    float getMaxDelay();
+
+#ifndef SWIGLUA
+    virtual void process();
+    od::Inlet mLeftInput{"Left In"};
+    od::Inlet mRightInput{"Right In"};
+    od::Outlet mLeftOutput{"Left Out"};
+    od::Outlet mRightOutput{"Right Out"};
+    od::Parameter mLeftDelay{"Left Delay"};
+    od::Parameter mRightDelay{"Right Delay"};
+#endif
+
+  private:
+    void processChannel(ChunkedDelayLine &line, float *in, float *out, float delay);
+
+    ChunkedDelayLine mLeftLine;
+    ChunkedDelayLine mRightLine;
+    std::atomic<bool> mEnabled{false};
+  };
+} /* namespace fdelay */
@@ -0,0 +1,136 @@
+#include <MipMapHistory.h>
+#include <od/AudioThread.h>
+#include <od/config.h>
+#include <hal/ops.h>
+#include <math.h>
+#include <string.h>
+
+namespace fdelay
+{
+
+  // 11-tap half-band, (3, 0, -25, 0, 150, 256, 150, 0, -25, 0, 3) / 512
+  static const float c1 = 150.0f / 512.0f;
+  static const float c3 = -25.0f / 512.0f;
+  static const float c5 = 3.0f / 512.0f;
+
+  MipMapHistory::MipMapHistory()
+  {
+  }
+
+  MipMapHistory::~MipMapHistory()
+  {
+    deallocate();
+  }
+
+  int MipMapHistory::allocate(int levels, int maxDelayInSamples)
+  {
+    deallocate();
+
+    // every level must receive a whole number of samples per frame
+    levels = CLAMP(0, mMaxLevels, levels);
+    while (levels > 0 && globalConfig.frameLength % (1 << levels) != 0)
+    {
+      levels--;
+    }
+
+    for (int i = 0; i < levels; i++)
+    {
+      int factor = 2 << i;
+      mMaxDelayInSamples[i] = maxDelayInSamples / factor;
+      mFifos[i].setSampleRate(globalConfig.sampleRate / factor);
+      if (!mFifos[i].allocateBuffer(1, mMaxDelayInSamples[i] + 2 * globalConfig.frameLength / factor))
+      {
+        break;
+      }
+      mFifos[i].zeroAndFill();
+      memset(mTaps[i], 0, sizeof(mTaps[i]));
+      mLevels = i + 1;
+    }
+
+    if (mLevels > 0)
+    {
+      mScratch.resize(globalConfig.frameLength + mTapCount);
+    }
+    return mLevels;
+  }
+
+  void MipMapHistory::deallocate()
+  {
+    for (int i = 0; i < mLevels; i++)
+    {
+      mFifos[i].deallocate();
+    }
+    mLevels = 0;
+  }
+
+  int MipMapHistory::getLevels()
+  {
+    return mLevels;
+  }
+
+  void MipMapHistory::decimate(float *taps, const float *in, int n, float *out)
+  {
+    float *x = mScratch.data();
+    memcpy(x, taps, sizeof(float) * mTapCount);
+    memcpy(x + mTapCount, in, sizeof(float) * n);
+
+    // only every other input sample is an output, and every other tap is zero
+    for (int m = 0; m < n / 2; m++)
+    {
+      const float *p = x + 2 * m + mTapCount / 2;
+      out[m] = 0.5f * p[0] + c1 * (p[-1] + p[1]) + c3 * (p[-3] + p[3]) + c5 * (p[-5] + p[5]);
+    }
+
+    memcpy(taps, x + n, sizeof(float) * mTapCount);
+  }
+
+  void MipMapHistory::push(const float *in, int n)
+  {
+    if (mLevels == 0)
+    {
+      return;
+    }
+
+    float *out = od::AudioThread::getFrame();
+    for (int i = 0; i < mLevels; i++)
+    {
+      // each level is decimated from the one above it, in place after the first
+      decimate(mTaps[i], in, n, out);
+      n /= 2;
+      mFifos[i].pop(n);
+      mFifos[i].pushMono(out, n);
+      in = out;
+    }
+    od::AudioThread::releaseFrame(out);
+  }
+
+  int MipMapHistory::levelForSpeed(float speed)
+  {
+    // the lowest level that still keeps the step at or under one sample
+    float step = fabsf(speed);
+    int level = 0;
+    while (level < mLevels && step > 1.0f)
+    {
+      step *= 0.5f;
+      level++;
+    }
+    return level;
+  }
+
+  od::Sample *MipMapHistory::getSample(int level)
+  {
+    return mFifos[level - 1].getSample();
+  }
+
+  int MipMapHistory::toIndex(int level, int history)
+  {
+    // Each half-band stage centres its output mTapCount / 2 of its own input
+    // samples back, so a level lags the full-rate history by 5, 15 and 35
+    // full-rate samples at /2, /4 and /8.
+    int i = level - 1;
+    int frame = globalConfig.frameLength >> level;
+    int lag = (mTapCount / 2) * ((1 << level) - 1);
+    return ((history + lag) >> level) + mFifos[i].offsetToRecent(mMaxDelayInSamples[i] + frame);
+  }
+
+} /* namespace fdelay */
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <od/audio/SampleFifo.h>
+#include <vector>
+
+namespace fdelay
+{
+
+  // Half-band decimated copies (/2, /4, /8) of a mono delay history, kept in
+  // step with the full-rate buffer as frames are pushed. Each level is an
+  // ordinary Sample at a lower sample rate, so a grain reading it only needs
+  // setSample(): its phase increment scales down with the rate. A grain at
+  // speed 6 reading the /8 level consumes fewer samples per frame than a
+  // unity speed grain and sees no content above its own Nyquist.
+  class MipMapHistory
+  {
+  public:
+    MipMapHistory();
+    ~MipMapHistory();
+
+    static const int mMaxLevels = 3;
+
+    // UI thread, levels is the number of decimated copies (0 to 3)
+    int allocate(int levels, int maxDelayInSamples);
+    void deallocate();
+    int getLevels();
+
+    // audio thread
+    void push(const float *in, int n);
+    int levelForSpeed(float speed);
+    od::Sample *getSample(int level);
+    // start index in a level for a position given in full-rate samples
+    // after the oldest sample of the full-rate history
+    int toIndex(int level, int history);
+
+  private:
+    void decimate(float *taps, const float *in, int n, float *out);
+
+    static const int mTapCount = 10;
+
+    od::SampleFifo mFifos[mMaxLevels];
+    float mTaps[mMaxLevels][mTapCount];
+    int mMaxDelayInSamples[mMaxLevels];
+    std::vector<float> mScratch;
+    int mLevels = 0;
+  };
+
+} /* namespace fdelay */
@@ -17,6 +17,19 @@ namespace fdelay
   {
   }
 
+  inline float32x4_t MonoGrain::interpolate(float *recent0, float *recent1,
+                                            float *recent2, float *phase)
+  {
+    if (mInterpolation == mLinearInterpolation)
+    {
+      float32x4_t x0 = vld1q_f32(recent0);
+      float32x4_t x1 = vld1q_f32(recent1);
+      return vmlaq_f32(x1, vld1q_f32(phase), x0 - x1);
+    }
+    return simd_quadratic_interpolate_with_return(recent0, recent1,
+                                                  recent2, phase);
+  }
+
   inline void MonoGrain::incrementPhaseOnMono()
   {
     mPhase += mPhaseDelta;
@@ -73,6 +86,19 @@ namespace fdelay
     }
   }
 
+  inline void MonoGrain::gatherFromMono(int lanes, float *phase, float *recent0,
+                                        float *recent1, float *recent2)
+  {
+    for (int k = 0; k < lanes; k++)
+    {
+      incrementPhaseOnMono();
+      phase[k] = mPhase;
+      recent0[k] = mFifo[0];
+      recent1[k] = mFifo[1];
+      recent2[k] = mFifo[2];
+    }
+  }
+
   void MonoGrain::synthesizeFromMonoToMono(float *out)
   {
     if (mRemaining == 0)
@@ -97,39 +123,30 @@ namespace fdelay
     generateEnvelope(env + mDelayInSamples, n);
     int N = n + mDelayInSamples;
 
-    for (int i = mDelayInSamples; i < N; i += 4)
+    int i = mDelayInSamples;
+    for (; i + 4 <= N; i += 4)
     {
-      incrementPhaseOnMono();
-      phase[0] = mPhase;
-      recent0[0] = mFifo[0];
-      recent1[0] = mFifo[1];
-      recent2[0] = mFifo[2];
-
-      incrementPhaseOnMono();
-      phase[1] = mPhase;
-      recent0[1] = mFifo[0];
-      recent1[1] = mFifo[1];
-      recent2[1] = mFifo[2];
+      gatherFromMono(4, phase, recent0, recent1, recent2);
 
-      incrementPhaseOnMono();
-      phase[2] = mPhase;
-      recent0[2] = mFifo[0];
-      recent1[2] = mFifo[1];
-      recent2[2] = mFifo[2];
-
-      incrementPhaseOnMono();
-      phase[3] = mPhase;
-      recent0[3] = mFifo[0];
-      recent1[3] = mFifo[1];
-      recent2[3] = mFifo[2];
-
-      float32x4_t x = simd_quadratic_interpolate_with_return(recent0, recent1,
-                                                             recent2, phase);
+      float32x4_t x = interpolate(recent0, recent1, recent2, phase);
       x *= vld1q_f32(env + i);
       float32x4_t o = vld1q_f32(out + i);
       vst1q_f32(out + i, vmlaq_f32(o, g, x));
     }
 
+    if (i < N)
+    {
+      // frame lengths that are not a multiple of 4
+      int r = N - i;
+      gatherFromMono(r, phase, recent0, recent1, recent2);
+      float x[4];
+      vst1q_f32(x, interpolate(recent0, recent1, recent2, phase));
+      for (int k = 0; k < r; k++)
+      {
+        out[i + k] += mLeftBalance * env[i + k] * x[k];
+      }
+    }
+
     mDelayInSamples = 0;
     mRemaining -= n;
     mActive = mRemaining > 0;
@@ -161,34 +178,12 @@ namespace fdelay
     generateEnvelope(env + mDelayInSamples, n);
     int N = n + mDelayInSamples;
 
-    for (int i = mDelayInSamples; i < N; i += 4)
+    int i = mDelayInSamples;
+    for (; i + 4 <= N; i += 4)
     {
-      incrementPhaseOnMono();
-      phase[0] = mPhase;
-      recent0[0] = mFifo[0];
-      recent1[0] = mFifo[1];
-      recent2[0] = mFifo[2];
+      gatherFromMono(4, phase, recent0, recent1, recent2);
 
-      incrementPhaseOnMono();
-      phase[1] = mPhase;
-      recent0[1] = mFifo[0];
-      recent1[1] = mFifo[1];
-      recent2[1] = mFifo[2];
-
-      incrementPhaseOnMono();
-      phase[2] = mPhase;
-      recent0[2] = mFifo[0];
-      recent1[2] = mFifo[1];
-      recent2[2] = mFifo[2];
-
-      incrementPhaseOnMono();
-      phase[3] = mPhase;
-      recent0[3] = mFifo[0];
-      recent1[3] = mFifo[1];
-      recent2[3] = mFifo[2];
-
-      float32x4_t x = simd_quadratic_interpolate_with_return(recent0, recent1,
-                                                             recent2, phase);
+      float32x4_t x = interpolate(recent0, recent1, recent2, phase);
       x *= vld1q_f32(env + i);
       float32x4_t L = vld1q_f32(left + i);
       vst1q_f32(left + i, vmlaq_f32(L, w1, x));
@@ -196,6 +191,21 @@ namespace fdelay
       vst1q_f32(right + i, vmlaq_f32(R, w2, x));
     }
 
+    if (i < N)
+    {
+      // frame lengths that are not a multiple of 4
+      int r = N - i;
+      gatherFromMono(r, phase, recent0, recent1, recent2);
+      float x[4];
+      vst1q_f32(x, interpolate(recent0, recent1, recent2, phase));
+      for (int k = 0; k < r; k++)
+      {
+        float y = env[i + k] * x[k];
+        left[i + k] += mLeftBalance * y;
+        right[i + k] += mRightBalance * y;
+      }
+    }
+
     mDelayInSamples = 0;
     mRemaining -= n;
     mActive = mRemaining > 0;
@@ -258,6 +268,19 @@ namespace fdelay
     }
   }
 
+  inline void MonoGrain::gatherFromStereo(int lanes, float *phase, float *recent0,
+                                          float *recent1, float *recent2)
+  {
+    for (int k = 0; k < lanes; k++)
+    {
+      incrementPhaseOnStereo();
+      phase[k] = mPhase;
+      recent0[k] = mFifo[0];
+      recent1[k] = mFifo[1];
+      recent2[k] = mFifo[2];
+    }
+  }
+
   void MonoGrain::synthesizeFromStereo(float *out)
   {
     if (mRemaining == 0)
@@ -281,43 +304,35 @@ namespace fdelay
     generateEnvelope(env + mDelayInSamples, n);
     int N = n + mDelayInSamples;
 
-    for (int i = mDelayInSamples; i < N; i += 4)
+    int i = mDelayInSamples;
+    for (; i + 4 <= N; i += 4)
     {
-      incrementPhaseOnStereo();
-      phase[0] = mPhase;
-      recent0[0] = mFifo[0];
-      recent1[0] = mFifo[1];
-      recent2[0] = mFifo[2];
-
-      incrementPhaseOnStereo();
-      phase[1] = mPhase;
-      recent0[1] = mFifo[0];
-      recent1[1] = mFifo[1];
-      recent2[1] = mFifo[2];
+      gatherFromStereo(4, phase, recent0, recent1, recent2);
 
-      incrementPhaseOnStereo();
-      phase[2] = mPhase;
-      recent0[2] = mFifo[0];
-      recent1[2] = mFifo[1];
-      recent2[2] = mFifo[2];
-
-      incrementPhaseOnStereo();
-      phase[3] = mPhase;
-      recent0[3] = mFifo[0];
-      recent1[3] = mFifo[1];
-      recent2[3] = mFifo[2];
-
-      float32x4_t x = simd_quadratic_interpolate_with_return(recent0, recent1,
-                                                             recent2, phase);
+      float32x4_t x = interpolate(recent0, recent1, recent2, phase);
       x *= vld1q_f32(env + i);
       float32x4_t o = vld1q_f32(out + i);
       vst1q_f32(out + i, vmlaq_f32(o, g, x));
     }
 
+    if (i < N)
+    {
+      // frame lengths that are not a multiple of 4
+      int r = N - i;
+      gatherFromStereo(r, phase, recent0, recent1, recent2);
+      float x[4];
+      vst1q_f32(x, interpolate(recent0, recent1, recent2, phase));
+      for (int k = 0; k < r; k++)
+      {
+        out[i + k] += mLeftBalance * env[i + k] * x[k];
+      }
+    }
+
     mDelayInSamples = 0;
     mRemaining -= n;
     mActive = mRemaining > 0;
-    mLastEnvelopeValue = env[FRAMELENGTH - 1];
+    // last value actually generated, the grain may end before the frame does
+    mLastEnvelopeValue = env[N - 1];
     od::AudioThread::releaseFrame(env);
   }
 
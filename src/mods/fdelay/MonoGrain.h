@@ -3,6 +3,7 @@
 #pragma once
 
 #include <Grain.h>
+#include <hal/simd.h>
 
 namespace fdelay
 {
@@ -20,6 +21,12 @@ namespace fdelay
     protected:
         inline void incrementPhaseOnMono();
         inline void incrementPhaseOnStereo();
+        inline float32x4_t interpolate(float *recent0, float *recent1,
+                                       float *recent2, float *phase);
+        inline void gatherFromMono(int lanes, float *phase, float *recent0,
+                                   float *recent1, float *recent2);
+        inline void gatherFromStereo(int lanes, float *phase, float *recent0,
+                                     float *recent1, float *recent2);
 
         float mFifo[3] = {0, 0, 0};
     };
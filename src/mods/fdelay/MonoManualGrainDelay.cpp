@@ -1,4 +1,6 @@
 #include <MonoManualGrainDelay.h>
+#include <AllocationAudit.h>
+#include <Trace.h>
 #include <od/config.h>
 #include <hal/ops.h>
 #include <algorithm>
@@ -7,6 +9,9 @@
 
 namespace fdelay
 {
+  // furthest a grain start is moved to reach a zero crossing
+  static const int snapWindow = 128;
+
   MonoManualGrainDelay::MonoManualGrainDelay(float secs, int grainCount)
   {
     addInput(mInput);
@@ -16,7 +21,11 @@ namespace fdelay
     addParameter(mDelay);
     addParameter(mDuration);
     addParameter(mSquash);
+    addParameter(mBank);
     addOutput(mOutput);
+    addOption(mGovernor);
+    addOption(mSnap);
+    addOption(mMipMap);
 
     setMaximumGrainCount(grainCount);
     setMaxDelay(secs);
@@ -24,6 +33,7 @@ namespace fdelay
 
   MonoManualGrainDelay::~MonoManualGrainDelay()
   {
+    setSharedBuffer(0);
   }
 
   int MonoManualGrainDelay::getGrainCount()
@@ -73,20 +83,97 @@ namespace fdelay
     mSampleFifo.setSampleRate(globalConfig.sampleRate);
     mSampleFifo.allocateBuffer(1, mMaxDelayInSamples + 2 * globalConfig.frameLength);
     mSampleFifo.zeroAndFill();
+    mZeroCrossings.resize(mSampleFifo.getSample()->mSampleCount);
+    allocateMipMap();
+    mFreezeBanks.allocate(mFreezeBankCount, mSampleFifo.getSample()->mSampleCount);
+    mGovernorState.checkClock();
+
+    mEnabled = true;
+    return mMaxDelayInSeconds;
+  }
+
+  void MonoManualGrainDelay::allocateMipMap()
+  {
+    if (mMipMap.value() == GRAIN_MIPMAP_ON)
+    {
+      mMipMapHistory.allocate(MipMapHistory::mMaxLevels, mMaxDelayInSamples);
+    }
+    else
+    {
+      mMipMapHistory.deallocate();
+    }
 
     for (MonoGrain &grain : mGrains)
     {
       grain.setSample(mSampleFifo.getSample());
     }
+  }
+
+  void MonoManualGrainDelay::updateMipMap()
+  {
+    bool on = mMipMap.value() == GRAIN_MIPMAP_ON;
+    if (on == (mMipMapHistory.getLevels() > 0))
+    {
+      return;
+    }
 
+    mEnabled = false;
+    stopAllGrains();
+    allocateMipMap();
+    mEnabled = true;
+  }
+
+  int MonoManualGrainDelay::setFreezeBankCount(int n)
+  {
+    mEnabled = false;
+    stopAllGrains();
+    mFreezeBankCount = mFreezeBanks.allocate(n, mSampleFifo.getSample()->mSampleCount);
+    mEnabled = true;
+    return mFreezeBankCount;
+  }
+
+  int MonoManualGrainDelay::getFreezeBankCount()
+  {
+    return mFreezeBankCount;
+  }
+
+  bool MonoManualGrainDelay::captureFreezeBank(int bank)
+  {
+    return mFreezeBanks.capture(bank);
+  }
+
+  bool MonoManualGrainDelay::isFreezeBankReady(int bank)
+  {
+    return mFreezeBanks.isReady(bank);
+  }
+
+  void MonoManualGrainDelay::setSharedBuffer(common::SharedBuffer *buffer)
+  {
+    if (buffer == mSharedBuffer)
+    {
+      return;
+    }
+
+    mEnabled = false;
+    stopAllGrains();
+    if (buffer)
+    {
+      buffer->attach();
+    }
+    if (mSharedBuffer)
+    {
+      mSharedBuffer->release();
+    }
+    mSharedBuffer = buffer;
     mEnabled = true;
-    return mMaxDelayInSeconds;
   }
 
   void MonoManualGrainDelay::setMaximumGrainCount(int n)
   {
     mFreeGrains.clear();
     mFreeGrains.reserve(n);
+    mActiveGrains.clear();
+    mActiveGrains.reserve(n);
     mGrains.resize(n);
     // push grains in a reverse memory order for better cache perf
     for (auto i = mGrains.rbegin(); i != mGrains.rend(); i++)
@@ -102,8 +189,51 @@ namespace fdelay
     }
   }
 
+  void MonoManualGrainDelay::setGovernorBudget(float fraction)
+  {
+    mGovernorState.setBudget(fraction);
+  }
+
+  float MonoManualGrainDelay::getGovernorBudget()
+  {
+    return mGovernorState.getBudget();
+  }
+
+  int MonoManualGrainDelay::getGovernorLevel()
+  {
+    return mGovernorState.getLevel();
+  }
+
+  float MonoManualGrainDelay::getGovernorLoad()
+  {
+    return mGovernorState.getLoad();
+  }
+
+  bool MonoManualGrainDelay::getGovernorAvailable()
+  {
+    return mGovernorState.isAvailable();
+  }
+
+  void MonoManualGrainDelay::applyGovernorLevel(MonoGrain *grain, int &durationSamples)
+  {
+    int level = mGovernorState.getLevel();
+    grain->setInterpolation(level >= Governor::mLevelLowOrder
+                                ? Grain::mLinearInterpolation
+                                : Grain::mQuadraticInterpolation);
+    if (level >= Governor::mLevelShortGrains)
+    {
+      durationSamples /= 2;
+    }
+  }
+
   MonoGrain *MonoManualGrainDelay::getNextFreeGrain()
   {
+    int activeCount = mGrains.size() - mFreeGrains.size();
+    if (mGrainCap > 0 && activeCount >= mGrainCap)
+    {
+      return 0;
+    }
+
     if (mEnabled && mFreeGrains.size() > 0)
     {
       MonoGrain *grain = mFreeGrains.back();
@@ -116,8 +246,17 @@ namespace fdelay
     }
   }
 
+  void MonoManualGrainDelay::pushFrame(float *in)
+  {
+    mSampleFifo.pop(FRAMELENGTH);
+    mSampleFifo.pushMono(in, FRAMELENGTH);
+    mZeroCrossings.push(in, FRAMELENGTH, mSampleFifo.offsetToRecent(FRAMELENGTH));
+    mMipMapHistory.push(in, FRAMELENGTH);
+  }
+
   void MonoManualGrainDelay::process()
   {
+    AUDIT_PROCESS();
     if (!mEnabled)
     {
       return;
@@ -128,28 +267,57 @@ namespace fdelay
     float *speed = mSpeed.buffer();
     float *freeze = mFreeze.buffer();
 
+#ifdef BUILDOPT_TESTING
+    if (mTracedMaxDelay != mMaxDelayInSeconds)
+    {
+      // setMaxDelay runs on the UI thread, report it from the audio thread
+      mTracedMaxDelay = mMaxDelayInSeconds;
+      TRACE(common::TRACE_MAX_DELAY, 0, mMaxDelayInSeconds, 0.0f);
+    }
+#endif
+
+    bool governed = mGovernor.value() == GRAIN_GOVERNOR_ON && mGovernorState.isAvailable();
+    if (governed)
+    {
+      mGovernorState.begin();
+      mGrainCap = mGovernorState.getLevel() >= Governor::mLevelCapGrains
+                      ? MAX(1, (int)mGrains.size() / 2)
+                      : 0;
+    }
+    else if (mGovernorState.getLevel() != Governor::mLevelNormal)
+    {
+      mGovernorState.reset();
+      mGrainCap = 0;
+    }
+
+    // copy the next slice of a pending capture before it can be overwritten
+    mFreezeBanks.update(mSampleFifo.getSample(),
+                        mSampleFifo.offsetToRecent(mMaxDelayInSamples + globalConfig.frameLength));
+
+    // fade over the frame when the freeze state changes
+    float ramp = 1.0f / FRAMELENGTH;
     if (freeze[0] <= 0.0f)
     {
       if (mFrozen)
       {
         mFrozen = false;
+        TRACE(common::TRACE_FREEZE, 0, 0.0f, 0.0f);
         for (int i = 0; i < FRAMELENGTH; i++)
         {
-          in[i] = in[i] * (float)i / (float)FRAMELENGTH;
+          in[i] *= i * ramp;
         }
       }
-      mSampleFifo.pop(FRAMELENGTH);
-      mSampleFifo.pushMono(in, FRAMELENGTH);
+      pushFrame(in);
     }
     else if (!mFrozen)
     {
       mFrozen = true;
+      TRACE(common::TRACE_FREEZE, 0, 1.0f, 0.0f);
       for (int i = 0; i < FRAMELENGTH; i++)
       {
-        in[i] = in[i] * (1.0 - (float)i / (float)FRAMELENGTH);
+        in[i] *= 1.0f - i * ramp;
       }
-      mSampleFifo.pop(FRAMELENGTH);
-      mSampleFifo.pushMono(in, FRAMELENGTH);
+      pushFrame(in);
     }
 
     // zero the output buffer
@@ -167,11 +335,57 @@ namespace fdelay
           int durationSamples = duration * globalConfig.sampleRate;
           int neededSamples = (durationSamples + 1) * speed[i];
           int delaySamples = MIN(delay * globalConfig.sampleRate, mMaxDelayInSamples + 2 * neededSamples);
-          int start = CLAMP(0, mMaxDelayInSamples, mMaxDelayInSamples - delaySamples);
-          start += mSampleFifo.offsetToRecent(mMaxDelayInSamples + globalConfig.frameLength);
+          int history = CLAMP(0, mMaxDelayInSamples, mMaxDelayInSamples - delaySamples);
+          int oldest = mSampleFifo.offsetToRecent(mMaxDelayInSamples + globalConfig.frameLength);
+          int start = history + oldest;
+          // banks are stored oldest first and read at full rate, the whole
+          // grain stays inside the captured part
+          od::Sample *sample = mFreezeBanks.getSample((int)(mBank.value() + 0.5f));
+          if (sample)
+          {
+            start = CLAMP(MAX(0, -neededSamples),
+                          mFreezeBanks.getLength() - 1 - MAX(0, neededSamples), history);
+          }
+          else if (mSharedBuffer)
+          {
+            // stay inside the published length, grains wrap at the capacity
+            int length = mSharedBuffer->getLength();
+            start = mSharedBuffer->getHead() - MIN(delaySamples, length - 1);
+            if (start < 0)
+            {
+              start += mSharedBuffer->mSampleCount;
+            }
+            sample = mSharedBuffer;
+          }
+          else
+          {
+            if (mSnap.value() == GRAIN_SNAP_ON)
+            {
+              // stay inside the written history
+              start = mZeroCrossings.snap(start, MIN(snapWindow, history),
+                                          MIN(snapWindow, mMaxDelayInSamples - history));
+            }
+            // fast grains read a decimated copy at a matching rate
+            int level = mMipMapHistory.levelForSpeed(speed[i]);
+            sample = level > 0 ? mMipMapHistory.getSample(level) : mSampleFifo.getSample();
+            if (level > 0)
+            {
+              start = mMipMapHistory.toIndex(level, start - oldest);
+            }
+          }
+          if (grain->mpSample != sample)
+          {
+            grain->setSample(sample);
+          }
           float gain = mGainCompensation[mFreeGrains.size()];
+          applyGovernorLevel(grain, durationSamples);
           grain->init(start, durationSamples, speed[i], gain, 0.0f);
           grain->setSquash(mSquash.value());
+          TRACE(common::TRACE_GRAIN_START, grain - &mGrains[0], speed[i], durationSamples);
+        }
+        else
+        {
+          TRACE(common::TRACE_GRAIN_DROP, 0, speed[i], 0.0f);
         }
         // Only try to produce one grain per frame
         break;
@@ -192,11 +406,24 @@ namespace fdelay
 
     for (MonoGrain *grain : mActiveGrains)
     {
-      grain->synthesizeFromMonoToMono(out);
+      if (grain->mpSample->mChannelCount == 2)
+      {
+        grain->synthesizeFromStereo(out);
+      }
+      else
+      {
+        grain->synthesizeFromMonoToMono(out);
+      }
       if (!grain->mActive)
       {
+        TRACE(common::TRACE_GRAIN_STOP, grain - &mGrains[0], 0.0f, 0.0f);
         mFreeGrains.push_back(grain);
       }
     }
+
+    if (governed)
+    {
+      mGovernorState.end();
+    }
   }
 } /* namespace fdelay */
@@ -3,8 +3,22 @@
 #include <od/objects/Object.h>
 #include <od/audio/SampleFifo.h>
 #include <MonoGrain.h>
+#include <Governor.h>
+#include <ZeroCrossingIndex.h>
+#include <MipMapHistory.h>
+#include <FreezeBanks.h>
+#include <SharedBuffer.h>
 #include <array>
 
+#define GRAIN_GOVERNOR_ON 1
+#define GRAIN_GOVERNOR_OFF 2
+
+#define GRAIN_SNAP_ON 1
+#define GRAIN_SNAP_OFF 2
+
+#define GRAIN_MIPMAP_ON 1
+#define GRAIN_MIPMAP_OFF 2
+
 namespace fdelay
 {
   class MonoManualGrainDelay : public od::Object
@@ -16,6 +30,30 @@ namespace fdelay
     float setMaxDelay(float secs);
     float getMaxDelay();
 
+    // CPU governor, budget is a fraction of the frame period
+    void setGovernorBudget(float fraction);
+    float getGovernorBudget();
+    int getGovernorLevel();
+    float getGovernorLoad();
+    // false when there is no running tick source to measure the load with
+    bool getGovernorAvailable();
+
+    // (de)allocates the decimated history after the Mip Map option changed
+    void updateMipMap();
+
+    // Captured copies of the history, selected by the Bank parameter (0 reads
+    // the live history). A bank takes memory from its first capture, which
+    // completes over the following frames.
+    int setFreezeBankCount(int n);
+    int getFreezeBankCount();
+    bool captureFreezeBank(int bank);
+    bool isFreezeBankReady(int bank);
+
+    // Grains read a buffer published by another unit instead of the live
+    // history, the delay counting back from its write position. Null goes
+    // back to the live history.
+    void setSharedBuffer(common::SharedBuffer *buffer);
+
 #ifndef SWIGLUA
     virtual void process();
     od::Inlet mInput{"In"};
@@ -25,7 +63,11 @@ namespace fdelay
     od::Parameter mDelay{"Delay"};
     od::Parameter mDuration{"Duration"};
     od::Parameter mSquash{"Squash"};
+    od::Parameter mBank{"Bank", 0.0f};
     od::Outlet mOutput{"Out"};
+    od::Option mGovernor{"Governor", GRAIN_GOVERNOR_OFF};
+    od::Option mSnap{"Snap", GRAIN_SNAP_ON};
+    od::Option mMipMap{"Mip Map", GRAIN_MIPMAP_OFF};
 
     int getGrainCount();
     Grain *getGrain(int index);
@@ -44,11 +86,25 @@ namespace fdelay
     MonoGrain *getNextFreeGrain();
     void setMaximumGrainCount(int n);
     void stopAllGrains();
+    void pushFrame(float *in);
 
     float mMaxDelayInSeconds = 0.0f;
     int mMaxDelayInSamples = 0;
 
     bool mFrozen = false;
+    ZeroCrossingIndex mZeroCrossings;
+    MipMapHistory mMipMapHistory;
+    void allocateMipMap();
+    FreezeBanks mFreezeBanks;
+    int mFreezeBankCount = 0;
+    common::SharedBuffer *mSharedBuffer = 0;
+#ifdef BUILDOPT_TESTING
+    float mTracedMaxDelay = -1.0f;
+#endif
+
+    Governor mGovernorState;
+    int mGrainCap = 0;
+    void applyGovernorLevel(MonoGrain *grain, int &durationSamples);
 
     std::atomic<bool> mEnabled{false};
   };
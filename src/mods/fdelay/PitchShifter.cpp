@@ -0,0 +1,130 @@
+#include <PitchShifter.h>
+#include <AllocationAudit.h>
+#include <Trace.h>
+#include <od/config.h>
+#include <hal/ops.h>
+#include <string.h>
+
+namespace fdelay
+{
+  // samples kept between the read and write heads for the interpolator
+  static const int guardSamples = 4;
+  // longest Window in seconds, sets the size of the delay memory
+  static const float maxWindow = 0.25f;
+
+  PitchShifter::PitchShifter()
+  {
+    addInput(mInput);
+    addInput(mSpeed);
+    addParameter(mWindow);
+    addOutput(mOutput);
+    addOption(mVoices);
+
+    mMaxDelayInSamples = (int)(maxWindow * globalConfig.sampleRate) + 2 * guardSamples;
+    mSampleFifo.setSampleRate(globalConfig.sampleRate);
+    mSampleFifo.allocateBuffer(1, mMaxDelayInSamples + 2 * globalConfig.frameLength);
+    mSampleFifo.zeroAndFill();
+
+    for (MonoGrain &grain : mGrains)
+    {
+      grain.setSample(mSampleFifo.getSample());
+      grain.setEnvelope(Grain::mHanningWindow);
+    }
+  }
+
+  PitchShifter::~PitchShifter()
+  {
+  }
+
+  int PitchShifter::grainDuration(float ratio)
+  {
+    float window = CLAMP(0.01f, maxWindow, mWindow.value()) * globalConfig.sampleRate;
+    // same rounding as Grain::init
+    int duration = MAX(64, (int)(window / MAX(1.0f, ratio)));
+    return 4 * (duration / 4);
+  }
+
+  int PitchShifter::startGrain(int offset, float ratio, int voices)
+  {
+    MonoGrain *grain = 0;
+    int active = 0;
+    for (MonoGrain &candidate : mGrains)
+    {
+      if (candidate.mActive)
+      {
+        active++;
+      }
+      else if (grain == 0)
+      {
+        grain = &candidate;
+      }
+    }
+
+    if (grain == 0 || active >= voices)
+    {
+      // a longer grain from before a ratio change is still sounding
+      return 0;
+    }
+
+    int duration = grainDuration(ratio);
+
+    // Start far enough back that the read head never overtakes the write
+    // head (upwards) or falls out of the window (downwards).
+    float delay = guardSamples + MAX(0.0f, (ratio - 1.0f) * duration);
+    delay = MIN(delay, (float)(mMaxDelayInSamples - guardSamples));
+
+    float position = mMaxDelayInSamples - delay + offset;
+    position += mSampleFifo.offsetToRecent(mMaxDelayInSamples + globalConfig.frameLength);
+    int start = (int)position;
+
+    // Hanning windows at a hop of duration/voices sum to voices/2.
+    grain->init(start, duration, ratio, 2.0f / voices, 0.0f);
+    grain->mPhase = position - start;
+    grain->setDelay(offset);
+    TRACE(common::TRACE_GRAIN_START, grain - &mGrains[0], ratio, duration);
+    return duration;
+  }
+
+  void PitchShifter::process()
+  {
+    AUDIT_PROCESS();
+    float *in = mInput.buffer();
+    float *speed = mSpeed.buffer();
+    float *out = mOutput.buffer();
+
+    mSampleFifo.pop(FRAMELENGTH);
+    mSampleFifo.pushMono(in, FRAMELENGTH);
+
+    memset(out, 0, sizeof(float) * FRAMELENGTH);
+
+    int voices = CLAMP(2, mMaxVoices, mVoices.value() + 1);
+    while (mCountdown < FRAMELENGTH)
+    {
+      // Grains start on NEON boundaries, the read position of the grain is
+      // taken at that same sample so the crossfade stays phase-locked.
+      int offset = 4 * ((int)mCountdown / 4);
+      float ratio = CLAMP(0.25f, 4.0f, speed[offset]);
+      int duration = startGrain(offset, ratio, voices);
+      if (duration == 0)
+      {
+        // retry at the start of the next frame
+        mCountdown = FRAMELENGTH;
+        break;
+      }
+      mCountdown += (float)duration / voices;
+    }
+    mCountdown -= FRAMELENGTH;
+
+    for (MonoGrain &grain : mGrains)
+    {
+      if (grain.mActive)
+      {
+        grain.synthesizeFromMonoToMono(out);
+        if (!grain.mActive)
+        {
+          TRACE(common::TRACE_GRAIN_STOP, &grain - &mGrains[0], 0.0f, 0.0f);
+        }
+      }
+    }
+  }
+} /* namespace fdelay */
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <od/objects/Object.h>
+#include <od/audio/SampleFifo.h>
+#include <MonoGrain.h>
+#include <array>
+
+namespace fdelay
+{
+  // Delay-line pitch shifter on top of the grain engine. A fixed set of two to
+  // four voices is scheduled from one master phase, so the Hanning windows of
+  // consecutive grains always overlap by exactly the same amount and sum to a
+  // constant. The grain length follows the pitch ratio: upward shifts get
+  // shorter grains so no grain ever reads more than Window seconds of input.
+  class PitchShifter : public od::Object
+  {
+  public:
+    PitchShifter();
+    virtual ~PitchShifter();
+
+    static const int mMaxVoices = 4;
+
+#ifndef SWIGLUA
+    virtual void process();
+    od::Inlet mInput{"In"};
+    od::Inlet mSpeed{"Speed"};
+    od::Parameter mWindow{"Window", 0.05f};
+    od::Outlet mOutput{"Out"};
+    // 1, 2 or 3 for two, three or four voices
+    od::Option mVoices{"Voices", 1};
+#endif
+
+  private:
+    od::SampleFifo mSampleFifo;
+    std::array<MonoGrain, mMaxVoices> mGrains;
+
+    int grainDuration(float ratio);
+    int startGrain(int offset, float ratio, int voices);
+
+    // samples until the next grain, relative to the frame start
+    float mCountdown = 0.0f;
+    int mMaxDelayInSamples = 0;
+  };
+} /* namespace fdelay */
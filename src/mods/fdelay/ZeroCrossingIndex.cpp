@@ -0,0 +1,178 @@
+#include <ZeroCrossingIndex.h>
+#include <hal/simd.h>
+#include <hal/ops.h>
+#include <string.h>
+
+namespace fdelay
+{
+
+  void ZeroCrossingIndex::resize(int size)
+  {
+    mSize = MAX(0, size);
+    mBits.assign((mSize + 31) / 32, 0);
+    mLast = 0.0f;
+  }
+
+  void ZeroCrossingIndex::clear()
+  {
+    if (mBits.size() > 0)
+    {
+      memset(mBits.data(), 0, sizeof(uint32_t) * mBits.size());
+    }
+    mLast = 0.0f;
+  }
+
+  inline void ZeroCrossingIndex::set(int i, bool crossing)
+  {
+    uint32_t bit = 1u << (i & 31);
+    if (crossing)
+    {
+      mBits[i >> 5] |= bit;
+    }
+    else
+    {
+      mBits[i >> 5] &= ~bit;
+    }
+  }
+
+  inline void ZeroCrossingIndex::store(int i, uint32_t nibble)
+  {
+    int shift = i & 31;
+    if (shift <= 28 && i + 4 <= mSize)
+    {
+      uint32_t &word = mBits[i >> 5];
+      word = (word & ~(0xFu << shift)) | (nibble << shift);
+      return;
+    }
+
+    // straddles a word or the end of the buffer
+    for (int k = 0; k < 4; k++, i++)
+    {
+      if (i >= mSize)
+      {
+        i -= mSize;
+      }
+      set(i, (nibble >> k) & 1);
+    }
+  }
+
+  void ZeroCrossingIndex::push(const float *in, int n, int position)
+  {
+    if (mSize == 0)
+    {
+      return;
+    }
+
+    position %= mSize;
+    float32x4_t zero = vdupq_n_f32(0.0f);
+    float32x4_t prev = vdupq_n_f32(mLast);
+    int i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+      float32x4_t x = vld1q_f32(in + i);
+      // sign of each sample against the sample before it
+      float32x4_t shifted = vextq_f32(prev, x, 3);
+      uint32x4_t crossing = veorq_u32(vcltq_f32(x, zero), vcltq_f32(shifted, zero));
+      uint32_t nibble = (vgetq_lane_u32(crossing, 0) & 1) |
+                        (vgetq_lane_u32(crossing, 1) & 2) |
+                        (vgetq_lane_u32(crossing, 2) & 4) |
+                        (vgetq_lane_u32(crossing, 3) & 8);
+      int j = position + i;
+      store(j < mSize ? j : j - mSize, nibble);
+      prev = x;
+    }
+
+    if (i > 0)
+    {
+      mLast = in[i - 1];
+    }
+
+    // frame lengths that are not a multiple of 4
+    for (; i < n; i++)
+    {
+      int j = (position + i) % mSize;
+      set(j, (in[i] < 0.0f) != (mLast < 0.0f));
+      mLast = in[i];
+    }
+  }
+
+  int ZeroCrossingIndex::distanceForward(int i, int limit)
+  {
+    int d = 0;
+    while (d <= limit)
+    {
+      int shift = i & 31;
+      int span = MIN(32 - shift, mSize - i);
+      uint32_t bits = mBits[i >> 5] >> shift;
+      if (span < 32)
+      {
+        bits &= (1u << span) - 1;
+      }
+      if (bits)
+      {
+        d += __builtin_ctz(bits);
+        return d <= limit ? d : -1;
+      }
+      d += span;
+      i += span;
+      if (i >= mSize)
+      {
+        i = 0;
+      }
+    }
+    return -1;
+  }
+
+  int ZeroCrossingIndex::distanceBackward(int i, int limit)
+  {
+    int d = 0;
+    while (d <= limit)
+    {
+      int shift = i & 31;
+      uint32_t bits = mBits[i >> 5];
+      if (shift < 31)
+      {
+        bits &= (2u << shift) - 1;
+      }
+      if (bits)
+      {
+        d += shift - (31 - __builtin_clz(bits));
+        return d <= limit ? d : -1;
+      }
+      d += shift + 1;
+      i -= shift + 1;
+      if (i < 0)
+      {
+        i = mSize - 1;
+      }
+    }
+    return -1;
+  }
+
+  int ZeroCrossingIndex::snap(int position, int backward, int forward)
+  {
+    if (mSize == 0)
+    {
+      return position;
+    }
+
+    int i = position % mSize;
+    if (i < 0)
+    {
+      i += mSize;
+    }
+
+    int ahead = distanceForward(i, MAX(0, forward));
+    int behind = distanceBackward(i, MAX(0, backward));
+    if (ahead < 0 && behind < 0)
+    {
+      return position;
+    }
+    if (behind < 0 || (ahead >= 0 && ahead < behind))
+    {
+      return position + ahead;
+    }
+    return position - behind;
+  }
+
+} /* namespace fdelay */
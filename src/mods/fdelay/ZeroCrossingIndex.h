@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+namespace fdelay
+{
+
+  // One bit per sample of a delay buffer, set where the signal changes sign
+  // between the previous sample and this one. The bits are written as frames
+  // are pushed, so finding the crossing nearest to a grain start only scans a
+  // few words instead of reading samples back out of the buffer.
+  class ZeroCrossingIndex
+  {
+  public:
+    // UI thread, together with the buffer allocation
+    void resize(int size);
+
+    // audio thread
+    void clear();
+    void push(const float *in, int n, int position);
+    int snap(int position, int backward, int forward);
+
+  private:
+    inline void set(int i, bool crossing);
+    inline void store(int i, uint32_t nibble);
+    int distanceForward(int i, int limit);
+    int distanceBackward(int i, int limit);
+
+    std::vector<uint32_t> mBits;
+    int mSize = 0;
+    float mLast = 0.0f;
+  };
+
+} /* namespace fdelay */
@@ -0,0 +1,206 @@
+local app = app
+local YBase = require "fdelay.YBase"
+local libfdelay = require "fdelay.libfdelay"
+local Class = require "Base.Class"
+local Unit = require "Unit"
+local GainBias = require "Unit.ViewControl.GainBias"
+local Encoder = require "Encoder"
+local OptionControl = require "Unit.MenuControl.OptionControl"
+local MenuHeader = require "Unit.MenuControl.Header"
+local Task = require "Unit.MenuControl.Task"
+local SamplePool = require "Sample.Pool"
+local SamplePoolInterface = require "Sample.Pool.Interface"
+local Timer = require "Timer"
+
+local Convolution = Class {}
+Convolution:include(YBase)
+
+function Convolution:init(args)
+  args.title = "Convolution"
+  args.mnemonic = "CV"
+  Unit.init(self, args)
+  YBase.init(self, args)
+end
+
+function Convolution:onLoadGraph(channelCount)
+  local convolver = self:addObject("convolver", libfdelay.Convolver(4.0))
+
+  local xfade = self:addObject("xfade", app.StereoCrossFade())
+  local fader = self:createControl("fader", app.GainBias())
+  connect(fader, "Out", xfade, "Fade")
+
+  connect(self, "In1", convolver, "Left In")
+  connect(self, "In1", xfade, "Left B")
+  connect(convolver, "Left Out", xfade, "Left A")
+  connect(xfade, "Left Out", self, "Out1")
+
+  if channelCount == 2 then
+    connect(self, "In2", convolver, "Right In")
+    connect(self, "In2", xfade, "Right B")
+    connect(convolver, "Right Out", xfade, "Right A")
+    connect(xfade, "Right Out", self, "Out2")
+  else
+    connect(self, "In1", convolver, "Right In")
+  end
+end
+
+-- The impulse response is transformed when it is set. A sample that is
+-- still loading is polled from a UI timer and set once it has loaded.
+function Convolution:setSample(sample)
+  self:stopWaitingForSample()
+  if self.sample then
+    self.sample:release(self)
+  end
+  self.sample = sample
+  if self.sample then
+    self.sample:claim(self)
+  end
+
+  if sample == nil then
+    self.objects.convolver:setSample(nil)
+  elseif sample:isPending() then
+    self.objects.convolver:setSample(nil)
+    self.sampleTimer = Timer.every(0.1, function()
+      if not sample:isPending() then
+        self:stopWaitingForSample()
+        self.objects.convolver:setSample(sample.pSample)
+      end
+    end)
+  else
+    self.objects.convolver:setSample(sample.pSample)
+  end
+end
+
+function Convolution:stopWaitingForSample()
+  if self.sampleTimer then
+    Timer.cancel(self.sampleTimer)
+    self.sampleTimer = nil
+  end
+end
+
+function Convolution:doAttachSampleFromCard()
+  local task = function(sample)
+    if sample then
+      self:setSample(sample)
+    end
+  end
+  SamplePool.chooseFileFromCard(self.loadInfo.id, task)
+end
+
+function Convolution:doAttachSampleFromPool()
+  local chooser = SamplePoolInterface(self.loadInfo.id, "choose")
+  chooser:setDefaultChannelCount(2)
+  chooser:highlight(self.sample)
+  local task = function(sample)
+    if sample then
+      self:setSample(sample)
+    end
+  end
+  chooser:subscribe("done", task)
+  chooser:show()
+end
+
+local menu = {
+  "sampleHeader",
+  "selectFromCard",
+  "selectFromPool",
+  "detachSample",
+  "partitioningHeader",
+  "partitioning"
+}
+
+function Convolution:onShowMenu(objects, branches)
+  local controls = {}
+
+  controls.sampleHeader = MenuHeader {
+    description = string.format("Impulse Response: %0.2fs of %0.1fs max.",
+      objects.convolver:getLength(), objects.convolver:getMaxLength())
+  }
+
+  controls.selectFromCard = Task {
+    description = "Select from Card",
+    task = function()
+      self:doAttachSampleFromCard()
+    end
+  }
+
+  controls.selectFromPool = Task {
+    description = "Select from Pool",
+    task = function()
+      self:doAttachSampleFromPool()
+    end
+  }
+
+  controls.detachSample = Task {
+    description = "Detach",
+    task = function()
+      self:setSample(nil)
+    end
+  }
+
+  controls.partitioningHeader = MenuHeader {
+    description = "Partitioning"
+  }
+
+  controls.partitioning = OptionControl {
+    description = "Blocks",
+    option = objects.convolver:getOption("Partitioning"),
+    choices = {
+      "two-stage",
+      "uniform"
+    },
+    callback = function(choice)
+      -- the IR is transformed again for the new block layout
+      self:setSample(self.sample)
+    end
+  }
+
+  return controls, menu
+end
+
+function Convolution:onLoadViews(objects, branches)
+  local controls = {}
+  local views = {
+    expanded = {
+      "wet"
+    },
+    collapsed = {}
+  }
+
+  controls.wet = GainBias {
+    button = "wet",
+    branch = branches.fader,
+    description = "Wet/Dry",
+    gainbias = objects.fader,
+    range = objects.faderRange,
+    biasMap = Encoder.getMap("unit"),
+    initialBias = 0.5
+  }
+
+  return controls, views
+end
+
+function Convolution:serialize()
+  local t = Unit.serialize(self)
+  if self.sample then
+    t.sample = SamplePool.serializeSample(self.sample)
+  end
+  return t
+end
+
+function Convolution:deserialize(t)
+  Unit.deserialize(self, t)
+  if t.sample then
+    local sample = SamplePool.deserializeSample(t.sample)
+    if sample then
+      self:setSample(sample)
+    end
+  end
+end
+
+function Convolution:onRemove()
+  self:setSample(nil)
+  Unit.onRemove(self)
+end
+
+return Convolution
@@ -31,6 +31,7 @@ local Class = require "Base.Class"
 local Unit = require "Unit"
 local Encoder = require "Encoder"
 local libcore = require "core.libcore"
+local libfdelay = require "fdelay.libfdelay"
 local Gate = require "Unit.ViewControl.Gate"
 local GainBias = require "Unit.ViewControl.GainBias"
 local Fader = require "Unit.ViewControl.Fader"
@@ -57,159 +58,138 @@ function FDN:init(args)
   YBase.init(self, args)
 end
 
-function FDN:onLoadGraph(channelCount)
-  local inLevelAdapter = self:createAdapterControl("inLevelAdapter")
-  local inLevelL = self:addObject("inLevelL", app.ConstantGain())
-  tie(inLevelL, "Gain", inLevelAdapter, "Out")
-  local inLevelR = self:addObject("inLevelR", app.ConstantGain())
-  tie(inLevelR, "Gain", inLevelAdapter, "Out")
-
-  local inFilter = self:addObject("inFilter", libcore.StereoFixedHPF())
+-- Fixed part of the network, shared by all instances.
+local graph = {
+  objects = {
+    {"inLevelL", app.ConstantGain},
+    {"inLevelR", app.ConstantGain},
+    {"inFilter", libcore.StereoFixedHPF},
+    {"xfade", app.StereoCrossFade},
+    {"inLMix", app.Sum},
+    {"inRMix", app.Sum},
+    {"delayTime1", app.ConstantGain, set = {Gain = 1.0}},
+    {"delayTime2", app.ConstantGain},
+    {"delayTime3", app.ConstantGain},
+    {"delayTime4", app.ConstantGain},
+    {"diffuser", libfdelay.Diffuser},
+    {"matrix", libfdelay.FeedbackMatrix},
+    {"half", app.Constant, set = {Value = 0.5}},
+    {"fdnMixL", app.Sum},
+    {"fdnMixR", app.Sum}
+  },
+  connections = {
+    {"fader", "Out", "xfade", "Fade"},
+    {"delay", "Out", "delayTime1", "In"},
+    {"delay", "Out", "delayTime2", "In"},
+    {"delay", "Out", "delayTime3", "In"},
+    {"delay", "Out", "delayTime4", "In"},
+
+    {"inFilter", "Left Out", "inLevelL", "In"},
+    {"inFilter", "Right Out", "inLevelR", "In"},
+    {"inLevelL", "Out", "diffuser", "Left In"},
+    {"inLevelR", "Out", "diffuser", "Right In"},
+    {"diffuser", "Left Out", "inLMix", "Left"},
+    {"diffuser", "Right Out", "inRMix", "Left"},
+    {"inLMix", "Out", "eq1", "In"},
+    {"inRMix", "Out", "eq2", "In"},
+
+    {"eq1", "Out", "delay1", "In"},
+    {"eq2", "Out", "delay2", "In"},
+    {"eq3", "Out", "delay3", "In"},
+    {"eq4", "Out", "delay4", "In"},
+
+    {"delay1", "Out", "matrix", "In1"},
+    {"delay2", "Out", "matrix", "In2"},
+    {"delay3", "Out", "matrix", "In3"},
+    {"delay4", "Out", "matrix", "In4"},
+
+    {"matrix", "Out1", "inLMix", "Right"},
+    {"matrix", "Out2", "eq3", "In"},
+    {"matrix", "Out3", "inRMix", "Right"},
+    {"matrix", "Out4", "eq4", "In"},
+
+    {"matrix", "Out1", "fdnMixL", "Left"},
+    {"matrix", "Out2", "fdnMixR", "Left"},
+    {"matrix", "Out3", "fdnMixL", "Right"},
+    {"matrix", "Out4", "fdnMixR", "Right"},
+
+    {"fdnMixL", "Out", "xfade", "Left A"},
+    {"fdnMixR", "Out", "xfade", "Right A"},
+
+    {"self", "In1", "xfade", "Left B"},
+    {"xfade", "Left Out", "self", "Out1"}
+  },
+  ties = {
+    {"inLevelL", "Gain", "inLevelAdapter", "Out"},
+    {"inLevelR", "Gain", "inLevelAdapter", "Out"},
+    {"diffuser", "Diffusion", "diffusionAdapter", "Out"}
+  }
+}
 
-  local xfade = self:addObject("xfade", app.StereoCrossFade())
-  local fader = self:createControl("fader", app.GainBias())
-  connect(fader, "Out", xfade, "Fade")
+local monoGraph = {
+  connections = {
+    {"self", "In1", "inFilter", "Left In"},
+    {"self", "In1", "inFilter", "Right In"}
+  }
+}
+
+local stereoGraph = {
+  connections = {
+    {"self", "In1", "inFilter", "Left In"},
+    {"self", "In2", "inFilter", "Right In"},
+    {"self", "In2", "xfade", "Right B"},
+    {"xfade", "Right Out", "self", "Out2"}
+  }
+}
 
-  local inLMix = self:addObject("inLMix", app.Sum())
-  local inRMix = self:addObject("inRMix", app.Sum())
+function FDN:onLoadGraph(channelCount)
+  self:createAdapterControl("inLevelAdapter")
+  self:createAdapterControl("diffusionAdapter")
+  self:createControl("fader", app.GainBias())
 
   local tone = self:createControl("tone", app.GainBias())
   local eqHigh = self:createEqHighControl(tone)
   local eqMid = self:createEqMidControl()
   local eqLow = self:createEqLowControl(tone)
 
-  local eq1 = self:createEq("eq1", eqHigh, eqMid, eqLow)
-  local eq2 = self:createEq("eq2", eqHigh, eqMid, eqLow)
-  local eq3 = self:createEq("eq3", eqHigh, eqMid, eqLow)
-  local eq4 = self:createEq("eq4", eqHigh, eqMid, eqLow)
-
-  local delay1 = self:addObject("delay1", libcore.DopplerDelay(self.delayMax + 0.1))
-  local delay2 = self:addObject("delay2", libcore.DopplerDelay(self.delayMax + 0.1))
-  local delay3 = self:addObject("delay3", libcore.DopplerDelay(self.delayMax + 0.1))
-  local delay4 = self:addObject("delay4", libcore.DopplerDelay(self.delayMax + 0.1))
-  local delay = self:createControl("delay", app.GainBias())
-  local delayTime1 = self:addObject("delayTime1", app.ConstantGain())
-  delayTime1:hardSet("Gain", 1.0)
-  connect(delay, "Out", delayTime1, "In")
-  local delayTime2 = self:addObject("delayTime2", app.ConstantGain())
-  delayTime2:hardSet("Gain", self.refl2 / self.refl1)
-  connect(delay, "Out", delayTime2, "In")
-  local delayTime3 = self:addObject("delayTime3", app.ConstantGain())
-  delayTime3:hardSet("Gain", self.refl3 / self.refl1)
-  connect(delay, "Out", delayTime3, "In")
-  local delayTime4 = self:addObject("delayTime4", app.ConstantGain())
-  delayTime4:hardSet("Gain", self.refl4 / self.refl1)
-  connect(delay, "Out", delayTime4, "In")
-
+  self:createEq("eq1", eqHigh, eqMid, eqLow)
+  self:createEq("eq2", eqHigh, eqMid, eqLow)
+  self:createEq("eq3", eqHigh, eqMid, eqLow)
+  self:createEq("eq4", eqHigh, eqMid, eqLow)
+
+  -- modulation adds up to 10% to each delay time
+  self:createLazyDelay("delay1", libfdelay.LazyDelay(self.delayMax + 0.1), 1.1)
+  self:createLazyDelay("delay2", libfdelay.LazyDelay(self.delayMax + 0.1), 1.1 * self.refl2 / self.refl1)
+  self:createLazyDelay("delay3", libfdelay.LazyDelay(self.delayMax + 0.1), 1.1 * self.refl3 / self.refl1)
+  self:createLazyDelay("delay4", libfdelay.LazyDelay(self.delayMax + 0.1), 1.1 * self.refl4 / self.refl1)
+  self:createControl("delay", app.GainBias())
   local modulation = self:createAdapterControl("modulation")
-  local modulatedDelayTime1 = self:modulate("modulatedDelayTime1", delayTime1, modulation, 0.13)
-  local modulatedDelayTime2 = self:modulate("modulatedDelayTime2", delayTime2, modulation, 0.17)
-  local modulatedDelayTime3 = self:modulate("modulatedDelayTime3", delayTime3, modulation, 0.19)
-  local modulatedDelayTime4 = self:modulate("modulatedDelayTime4", delayTime4, modulation, 0.23)
-
-  connect(modulatedDelayTime1, "Out", delay1, "Delay")
-  connect(modulatedDelayTime2, "Out", delay2, "Delay")
-  connect(modulatedDelayTime3, "Out", delay3, "Delay")
-  connect(modulatedDelayTime4, "Out", delay4, "Delay")
-
-  local dif11 = self:addObject("dif11", app.Sum())
-  local dif11r = self:negative("dif11", dif11)
-  local sum12 = self:addObject("sum12", app.Sum())
-  local sum12r = self:positive("sum12", sum12)
-  local dif13 = self:addObject("dif13", app.Sum())
-  local dif13r = self:negative("dif13", dif13)
-  local sum14 = self:addObject("sum14", app.Sum())
-  local sum14r = self:positive("sum14", sum14)
-
-  local dif21 = self:addObject("dif21", app.Sum())
-  local dif21r = self:negative("dif21", dif21)
-  local sum22 = self:addObject("sum22", app.Sum())
-  local sum22r = self:positive("sum22", sum22)
-  local dif23 = self:addObject("dif23", app.Sum())
-  local dif23r = self:negative("dif23", dif23)
-  local sum24 = self:addObject("sum24", app.Sum())
-  local sum24r = self:positive("sum24", sum24)
-
   local feedbackAdapter = self:createAdapterControl("feedbackAdapter")
-  local half = self:addObject("half", app.Constant())
-  half:hardSet("Value", 0.5)
-  local feedback1 = self:addObject("feedback1", app.ConstantGain())
-  feedback1:setClampInDecibels(-23.9)
-  tie(feedback1, "Gain", "*", half, "Value", feedbackAdapter, "Out")
-  local feedback2 = self:addObject("feedback2", app.ConstantGain())
-  feedback2:setClampInDecibels(-23.9)
-  tie(feedback2, "Gain", "*", half, "Value", feedbackAdapter, "Out")
-  local feedback3 = self:addObject("feedback3", app.ConstantGain())
-  feedback3:setClampInDecibels(-23.9)
-  tie(feedback3, "Gain", "*", half, "Value", feedbackAdapter, "Out")
-  local feedback4 = self:addObject("feedback4", app.ConstantGain())
-  feedback4:setClampInDecibels(-23.9)
-  tie(feedback4, "Gain", "*", half, "Value", feedbackAdapter, "Out")
-
-  local fdnMixL = self:addObject("fdnMixL", app.Sum())
-  local fdnMixR = self:addObject("fdnMixR", app.Sum())
 
+  self:buildGraph(graph)
   if channelCount == 2 then
-    connect(self, "In1", inFilter, "Left In")
-    connect(self, "In2", inFilter, "Right In")
+    self:buildGraph(stereoGraph)
   else
-    connect(self, "In1", inFilter, "Left In")
-    connect(self, "In1", inFilter, "Right In")
-  end
-  connect(inFilter, "Left Out", inLevelL, "In")
-  connect(inFilter, "Right Out", inLevelR, "In")
-  connect(inLevelL, "Out", inLMix, "Left")
-  connect(inLevelR, "Out", inRMix, "Left")
-  connect(inLMix, "Out", eq1, "In")
-  connect(inRMix, "Out", eq2, "In")
-
-  connect(eq1, "Out", delay1, "In")
-  connect(eq2, "Out", delay2, "In")
-  connect(eq3, "Out", delay3, "In")
-  connect(eq4, "Out", delay4, "In")
-
-  connect(delay1, "Out", dif11, "Left")
-  connect(delay1, "Out", sum12, "Left")
-  connect(delay2, "Out", dif11r, "In")
-  connect(delay2, "Out", sum12r, "In")
-  connect(delay3, "Out", dif13, "Left")
-  connect(delay3, "Out", sum14, "Left")
-  connect(delay4, "Out", dif13r, "In")
-  connect(delay4, "Out", sum14r, "In")
-
-  connect(dif11, "Out", dif21, "Left")
-  connect(dif11, "Out", sum22, "Left")
-  connect(sum12, "Out", dif23, "Left")
-  connect(sum12, "Out", sum24, "Left")
-  connect(dif13, "Out", dif21r, "In")
-  connect(dif13, "Out", sum22r, "In")
-  connect(sum14, "Out", dif23r, "In")
-  connect(sum14, "Out", sum24r, "In")
-
-  connect(dif21, "Out", feedback1, "In")
-  connect(sum22, "Out", feedback2, "In")
-  connect(dif23, "Out", feedback3, "In")
-  connect(sum24, "Out", feedback4, "In")
-
-  connect(feedback1, "Out", inLMix, "Right")
-  connect(feedback2, "Out", eq3, "In")
-  connect(feedback3, "Out", inRMix, "Right")
-  connect(feedback4, "Out", eq4, "In")
-
-  connect(feedback1, "Out", fdnMixL, "Left")
-  connect(feedback2, "Out", fdnMixR, "Left")
-  connect(feedback3, "Out", fdnMixL, "Right")
-  connect(feedback4, "Out", fdnMixR, "Right")
-
-  connect(fdnMixL, "Out", xfade, "Left A")
-  connect(fdnMixR, "Out", xfade, "Right A")
-
-  connect(self, "In1", xfade, "Left B")
-  connect(xfade, "Left Out", self, "Out1")
-  if channelCount == 2 then
-    connect(self, "In2", xfade, "Right B")
-    connect(xfade, "Right Out", self, "Out2")
+    self:buildGraph(monoGraph)
   end
+
+  local objects = self.objects
+  objects.delayTime2:hardSet("Gain", self.refl2 / self.refl1)
+  objects.delayTime3:hardSet("Gain", self.refl3 / self.refl1)
+  objects.delayTime4:hardSet("Gain", self.refl4 / self.refl1)
+
+  local modulatedDelayTime1 = self:modulate("modulatedDelayTime1", objects.delayTime1, modulation, 0.13)
+  local modulatedDelayTime2 = self:modulate("modulatedDelayTime2", objects.delayTime2, modulation, 0.17)
+  local modulatedDelayTime3 = self:modulate("modulatedDelayTime3", objects.delayTime3, modulation, 0.19)
+  local modulatedDelayTime4 = self:modulate("modulatedDelayTime4", objects.delayTime4, modulation, 0.23)
+
+  connect(modulatedDelayTime1, "Out", objects.delay1, "Delay")
+  connect(modulatedDelayTime2, "Out", objects.delay2, "Delay")
+  connect(modulatedDelayTime3, "Out", objects.delay3, "Delay")
+  connect(modulatedDelayTime4, "Out", objects.delay4, "Delay")
+
+  objects.matrix:setClampInDecibels(-23.9)
+  tie(objects.matrix, "Gain", "*", objects.half, "Value", feedbackAdapter, "Out")
 end
 
 function FDN:modulate(name, time, modulation, frequency)
@@ -245,7 +225,7 @@ end
 function FDN:onLoadViews(objects, branches)
   local controls = {}
   local views = {
-    expanded = {"delay", "feedback", "tone", "mod", "hpf", "input", "wet"},
+    expanded = {"delay", "feedback", "tone", "mod", "hpf", "diffuse", "input", "wet"},
     collapsed = {}
   }
 
@@ -300,6 +280,16 @@ function FDN:onLoadViews(objects, branches)
     scaling = app.octaveScaling
   }
 
+  controls.diffuse = GainBias {
+    button = "diffuse",
+    description = "Input Diffusion",
+    branch = branches.diffusionAdapter,
+    gainbias = objects.diffusionAdapter,
+    range = objects.diffusionAdapter,
+    biasMap = Encoder.getMap("unit"),
+    initialBias = 0.6
+  }
+
   controls.input = GainBias {
     button = "input",
     description = "FDN Input Level",
@@ -323,11 +313,13 @@ function FDN:onLoadViews(objects, branches)
   return controls, views
 end
 
+function FDN:deserialize(t)
+  Unit.deserialize(self, t)
+  self:reserveLazyDelays(self.objects.delay:getParameter("Bias"):target())
+end
+
 function FDN:onRemove()
-  self.objects.delay1:deallocate()
-  self.objects.delay2:deallocate()
-  self.objects.delay3:deallocate()
-  self.objects.delay4:deallocate()
+  self:removeLazyDelays()
   Unit.onRemove(self)
 end
 
@@ -0,0 +1,257 @@
+local app = app
+local YBase = require "fdelay.YBase"
+local libfdelay = require "fdelay.libfdelay"
+local libcore = require "core.libcore"
+local Class = require "Base.Class"
+local Unit = require "Unit"
+local GainBias = require "Unit.ViewControl.GainBias"
+local Pitch = require "Unit.ViewControl.Pitch"
+local Utils = require "Utils"
+local Encoder = require "Encoder"
+
+local GrainCloud = Class {}
+GrainCloud:include(YBase)
+
+function GrainCloud:init(args)
+  args.title = "Grain Cloud"
+  args.mnemonic = "GC"
+  Unit.init(self, args)
+  YBase.init(self, args)
+end
+
+function GrainCloud:onLoadGraph(channelCount)
+  local cloud = self:addObject("cloud", libfdelay.GrainCloud(5.0, 64))
+
+  local density = self:createAdapterControl("density")
+  local jitter = self:createAdapterControl("jitter")
+  local delay = self:createAdapterControl("delay")
+  local spray = self:createAdapterControl("spray")
+  local duration = self:createAdapterControl("duration")
+  local pitchSpread = self:createAdapterControl("pitchSpread")
+  local panSpread = self:createAdapterControl("panSpread")
+  local squash = self:createAdapterControl("squash")
+  tie(cloud, "Density", density, "Out")
+  tie(cloud, "Jitter", jitter, "Out")
+  tie(cloud, "Delay", delay, "Out")
+  tie(cloud, "Spray", spray, "Out")
+  tie(cloud, "Duration", duration, "Out")
+  tie(cloud, "Pitch Spread", pitchSpread, "Out")
+  tie(cloud, "Squash", squash, "Out")
+
+  local speed = self:createControl("speed", app.GainBias())
+  local tune = self:createControl("tune", app.ConstantOffset())
+  local pitch = self:addObject("pitch", libcore.VoltPerOctave())
+  local multiply = self:addObject("multiply", app.Multiply())
+  local clipper = self:addObject("clipper", libcore.Clipper())
+  clipper:setMaximum(64.0)
+  clipper:setMinimum(-64.0)
+
+  -- Pitch and Linear FM
+  connect(tune, "Out", pitch, "In")
+  connect(pitch, "Out", multiply, "Left")
+  connect(speed, "Out", multiply, "Right")
+  connect(multiply, "Out", clipper, "In")
+  connect(clipper, "Out", cloud, "Speed")
+
+  local xfade = self:addObject("xfade", app.StereoCrossFade())
+  local fader = self:createControl("fader", app.GainBias())
+  connect(fader, "Out", xfade, "Fade")
+
+  if channelCount == 2 then
+    tie(cloud, "Pan Spread", panSpread, "Out")
+
+    local inMix = self:addObject("inMix", app.Sum())
+    local inLevel = self:addObject("inLevel", app.ConstantGain())
+    inLevel:hardSet("Gain", 0.5)
+    connect(self, "In1", inMix, "Left")
+    connect(self, "In2", inMix, "Right")
+    connect(inMix, "Out", inLevel, "In")
+    connect(inLevel, "Out", cloud, "In")
+
+    connect(self, "In1", xfade, "Left B")
+    connect(self, "In2", xfade, "Right B")
+    connect(cloud, "Left Out", xfade, "Left A")
+    connect(cloud, "Right Out", xfade, "Right A")
+    connect(xfade, "Left Out", self, "Out1")
+    connect(xfade, "Right Out", self, "Out2")
+  else
+    cloud:hardSet("Pan Spread", 0.0)
+
+    connect(self, "In1", cloud, "In")
+    connect(self, "In1", xfade, "Left B")
+    connect(cloud, "Left Out", xfade, "Left A")
+    connect(xfade, "Left Out", self, "Out1")
+  end
+end
+
+local function timeMap(max, n)
+  local map = app.LinearDialMap(0, max)
+  map:setCoarseRadix(n)
+  return map
+end
+
+local function densityMap()
+  local map = app.LinearDialMap(0, 200)
+  map:setSteps(10, 1, 0.1, 0.01)
+  return map
+end
+
+local function semitoneMap()
+  local map = app.LinearDialMap(0, 24)
+  map:setSteps(1, 0.1, 0.01, 0.001)
+  return map
+end
+
+function GrainCloud:onLoadViews(objects, branches)
+  local controls = {}
+  local views = {collapsed = {}}
+
+  if self.channelCount == 2 then
+    views.expanded = {
+      "density",
+      "jitter",
+      "pitch",
+      "speed",
+      "duration",
+      "delay",
+      "spray",
+      "pspread",
+      "stereo",
+      "squash",
+      "wet"
+    }
+  else
+    views.expanded = {
+      "density",
+      "jitter",
+      "pitch",
+      "speed",
+      "duration",
+      "delay",
+      "spray",
+      "pspread",
+      "squash",
+      "wet"
+    }
+  end
+
+  controls.density = GainBias {
+    button = "dens",
+    description = "Density",
+    branch = branches.density,
+    gainbias = objects.density,
+    range = objects.density,
+    biasMap = densityMap(),
+    biasUnits = app.unitHertz,
+    initialBias = 10.0
+  }
+
+  controls.jitter = GainBias {
+    button = "jitter",
+    description = "Jitter",
+    branch = branches.jitter,
+    gainbias = objects.jitter,
+    range = objects.jitter,
+    biasMap = Encoder.getMap("unit"),
+    initialBias = 0.0
+  }
+
+  controls.pitch = Pitch {
+    button = "V/oct",
+    description = "V/oct",
+    branch = branches.tune,
+    offset = objects.tune,
+    range = objects.tuneRange
+  }
+
+  controls.speed = GainBias {
+    button = "speed",
+    branch = branches.speed,
+    description = "Speed",
+    gainbias = objects.speed,
+    range = objects.speedRange,
+    biasMap = Encoder.getMap("speed"),
+    biasUnits = app.unitNone,
+    initialBias = 1.0
+  }
+
+  controls.duration = GainBias {
+    button = "dur",
+    description = "Duration",
+    branch = branches.duration,
+    gainbias = objects.duration,
+    range = objects.duration,
+    biasMap = Encoder.getMap("unit"),
+    biasUnits = app.unitSecs,
+    initialBias = 0.1
+  }
+
+  local allocated = Utils.round(self.objects.cloud:getMaxDelay(), 1)
+
+  controls.delay = GainBias {
+    button = "delay",
+    description = "Delay",
+    branch = branches.delay,
+    gainbias = objects.delay,
+    range = objects.delay,
+    biasMap = timeMap(allocated, 100),
+    biasUnits = app.unitSecs
+  }
+
+  controls.spray = GainBias {
+    button = "spray",
+    description = "Spray",
+    branch = branches.spray,
+    gainbias = objects.spray,
+    range = objects.spray,
+    biasMap = timeMap(allocated, 100),
+    biasUnits = app.unitSecs
+  }
+
+  controls.pspread = GainBias {
+    button = "pspread",
+    description = "Pitch Spread",
+    branch = branches.pitchSpread,
+    gainbias = objects.pitchSpread,
+    range = objects.pitchSpread,
+    biasMap = semitoneMap(),
+    biasUnits = app.unitNone
+  }
+
+  if self.channelCount == 2 then
+    controls.stereo = GainBias {
+      button = "stereo",
+      description = "Pan Spread",
+      branch = branches.panSpread,
+      gainbias = objects.panSpread,
+      range = objects.panSpread,
+      biasMap = Encoder.getMap("unit"),
+      initialBias = 0.5
+    }
+  end
+
+  controls.squash = GainBias {
+    button = "squash",
+    description = "Squash",
+    branch = branches.squash,
+    gainbias = objects.squash,
+    range = objects.squash,
+    biasMap = Encoder.getMap("gain36dB"),
+    biasUnits = app.unitDecibels,
+    initialBias = 1.0
+  }
+
+  controls.wet = GainBias {
+    button = "wet",
+    branch = branches.fader,
+    description = "Wet/Dry",
+    gainbias = objects.fader,
+    range = objects.faderRange,
+    biasMap = Encoder.getMap("unit"),
+    initialBias = 0.5
+  }
+
+  return controls, views
+end
+
+return GrainCloud
@@ -12,10 +12,17 @@ local Encoder = require "Encoder"
 local OptionControl = require "Unit.MenuControl.OptionControl"
 local MenuHeader = require "Unit.MenuControl.Header"
 local Task = require "Unit.MenuControl.Task"
+local FS = require "Card.FileSystem"
+
+-- buffers published by other packages, only there when yloop is installed
+local hasSharedBuffers, SharedBuffers = pcall(require, "yloop.SharedBuffers")
 
 local ManualGrainDelay = Class {}
 ManualGrainDelay:include(YBase)
 
+-- banks take memory only once they are captured
+local freezeBankCount = 4
+
 function ManualGrainDelay:init(args)
   args.title = "Manual Grain Delay"
   args.mnemonic = "MGD"
@@ -33,6 +40,9 @@ function ManualGrainDelay:onLoadGraph(channelCount)
   tie(grainL, "Duration", duration, "Out")
   tie(grainL, "Delay", delay, "Out")
   tie(grainL, "Squash", squash, "Out")
+  local bank = self:createAdapterControl("bank")
+  tie(grainL, "Bank", bank, "Out")
+  grainL:setFreezeBankCount(freezeBankCount)
 
   local trig = self:addObject("trig", app.Comparator())
   self:addMonoBranch("trig", trig, "In", trig, "Out")
@@ -98,6 +108,8 @@ function ManualGrainDelay:onLoadGraph(channelCount)
     tie(grainR, "Duration", duration, "Out")
     tie(grainR, "Delay", delay, "Out")
     tie(grainR, "Squash", squash, "Out")
+    tie(grainR, "Bank", bank, "Out")
+    grainR:setFreezeBankCount(freezeBankCount)
     connect(freeze, "Out", grainR, "Freeze")
   
     local feedbackMixR = self:addObject("feedbackMixR", app.Sum())
@@ -133,6 +145,12 @@ local function timeMap(max, n)
   return map
 end
 
+local function bankMap()
+  local map = app.LinearDialMap(0, freezeBankCount)
+  map:setSteps(1, 1, 1, 1)
+  return map
+end
+
 local function feedbackMap()
   local map = app.LinearDialMap(-36, 6)
   map:setZero(-160)
@@ -159,9 +177,65 @@ local menu = {
   -- "set10s",
   -- "set30s",
   "freezeHeader",
-  "freeze"
+  "freeze",
+  "snap",
+  "mipmap",
+  "bankHeader",
+  "capture1",
+  "capture2",
+  "capture3",
+  "capture4",
+  "governorHeader",
+  "governor",
+  "budget5",
+  "budget10",
+  "budget20"
 }
 
+function ManualGrainDelay:setGovernorBudget(fraction)
+  self.objects.grainL:setGovernorBudget(fraction)
+  if self.objects.grainR then
+    self.objects.grainR:setGovernorBudget(fraction)
+  end
+end
+
+function ManualGrainDelay:captureFreezeBank(bank)
+  self.objects.grainL:captureFreezeBank(bank)
+  if self.objects.grainR then
+    self.objects.grainR:captureFreezeBank(bank)
+  end
+end
+
+-- The source is kept by name and saved with the unit. One that is not
+-- published (yet), e.g. a loop further down the chain while a preset loads,
+-- is attached as soon as it is.
+function ManualGrainDelay:setSharedBuffer(name)
+  self.sharedName = name
+  SharedBuffers.unwatch(self)
+  self:attachSharedBuffer(name and SharedBuffers.find(name))
+  if name then
+    SharedBuffers.watch(self, name, function(buffer)
+      self:attachSharedBuffer(buffer)
+    end)
+  end
+end
+
+function ManualGrainDelay:attachSharedBuffer(buffer)
+  self.objects.grainL:setSharedBuffer(buffer)
+  if self.objects.grainR then
+    self.objects.grainR:setSharedBuffer(buffer)
+  end
+end
+
+function ManualGrainDelay:updateMipMap()
+  local grainL = self.objects.grainL
+  grainL:updateMipMap()
+  if self.objects.grainR then
+    self.objects.grainR:setOptionValue("Mip Map", grainL:getOption("Mip Map"):value())
+    self.objects.grainR:updateMipMap()
+  end
+end
+
 function ManualGrainDelay:onShowMenu(objects, branches)
   local controls = {}
 
@@ -211,7 +285,142 @@ function ManualGrainDelay:onShowMenu(objects, branches)
     }
   }
 
-  return controls, menu
+  controls.snap = OptionControl {
+    description = "Snap to Zero",
+    option = objects.grainL:getOption("Snap"),
+    choices = {
+      "on",
+      "off"
+    },
+    callback = function(choice)
+      if objects.grainR then
+        objects.grainR:setOptionValue("Snap", choice)
+      end
+    end
+  }
+
+  controls.mipmap = OptionControl {
+    description = "Mip Map",
+    option = objects.grainL:getOption("Mip Map"),
+    choices = {
+      "on",
+      "off"
+    },
+    callback = function(choice)
+      self:updateMipMap()
+    end
+  }
+
+  controls.bankHeader = MenuHeader {
+    description = "Freeze Banks"
+  }
+
+  for i = 1, freezeBankCount do
+    local ready = objects.grainL:isFreezeBankReady(i)
+    controls["capture" .. i] = Task {
+      description = string.format("Capture bank %d%s", i, ready and " (full)" or ""),
+      task = function()
+        self:captureFreezeBank(i)
+      end
+    }
+  end
+
+  local grainL = self.objects.grainL
+  local governorStatus = "CPU Governor: unavailable, no cycle counter."
+  if grainL:getGovernorAvailable() then
+    governorStatus = string.format("CPU Governor: level %d, load %d%% of %d%%.",
+      grainL:getGovernorLevel(),
+      Utils.round(100 * grainL:getGovernorLoad()),
+      Utils.round(100 * grainL:getGovernorBudget()))
+  end
+  controls.governorHeader = MenuHeader {
+    description = governorStatus
+  }
+
+  controls.governor = OptionControl {
+    description = "Governor",
+    option = objects.grainL:getOption("Governor"),
+    choices = {
+      "on",
+      "off"
+    },
+    callback = function(choice)
+      if objects.grainR then
+        objects.grainR:setOptionValue("Governor", choice)
+      end
+    end
+  }
+
+  controls.budget5 = Task {
+    description = "Budget 5%",
+    task = function()
+      self:setGovernorBudget(0.05)
+    end
+  }
+
+  controls.budget10 = Task {
+    description = "Budget 10%",
+    task = function()
+      self:setGovernorBudget(0.10)
+    end
+  }
+
+  controls.budget20 = Task {
+    description = "Budget 20%",
+    task = function()
+      self:setGovernorBudget(0.20)
+    end
+  }
+
+  if libfdelay.traceEnabled() then
+    controls.traceDump = Task {
+      description = string.format("Dump trace (%d)", libfdelay.traceCount()),
+      task = function()
+        libfdelay.traceDump(FS.getRoot("rear") .. "/fdelay-trace.bin")
+      end
+    }
+  end
+
+  local items = {}
+  for _, name in ipairs(menu) do
+    items[#items + 1] = name
+  end
+  -- tracing is compiled out of release builds
+  if controls.traceDump then
+    items[#items + 1] = "traceDump"
+  end
+
+  if hasSharedBuffers then
+    local source = self.sharedName or "live"
+    if self.sharedName and SharedBuffers.find(self.sharedName) == nil then
+      source = source .. " (missing)"
+    end
+    controls.sourceHeader = MenuHeader {
+      description = string.format("Grain Source: %s", source)
+    }
+
+    controls.sourceLive = Task {
+      description = "Live",
+      task = function()
+        self:setSharedBuffer(nil)
+      end
+    }
+    items[#items + 1] = "sourceHeader"
+    items[#items + 1] = "sourceLive"
+
+    for i, name in ipairs(SharedBuffers.names()) do
+      local key = "source" .. i
+      controls[key] = Task {
+        description = name,
+        task = function()
+          self:setSharedBuffer(name)
+        end
+      }
+      items[#items + 1] = key
+    end
+  end
+
+  return controls, items
 end
 
 function ManualGrainDelay:onLoadViews(objects, branches)
@@ -222,6 +431,7 @@ function ManualGrainDelay:onLoadViews(objects, branches)
     views.expanded = {
       "trigger",
       "freeze",
+      "bank",
       "pitch",
       "speed",
       "duration",
@@ -235,6 +445,7 @@ function ManualGrainDelay:onLoadViews(objects, branches)
     views.expanded = {
       "trigger",
       "freeze",
+      "bank",
       "pitch",
       "speed",
       "duration",
@@ -260,6 +471,16 @@ function ManualGrainDelay:onLoadViews(objects, branches)
     comparator = objects.freeze
   }
 
+  controls.bank = GainBias {
+    button = "bank",
+    description = "Freeze Bank",
+    branch = branches.bank,
+    gainbias = objects.bank,
+    range = objects.bank,
+    biasMap = bankMap(),
+    biasUnits = app.unitNone
+  }
+
   controls.pitch = Pitch {
     button = "V/oct",
     description = "V/oct",
@@ -345,6 +566,31 @@ function ManualGrainDelay:onLoadViews(objects, branches)
   return controls, views
 end
 
+function ManualGrainDelay:serialize()
+  local t = Unit.serialize(self)
+  t.governorBudget = self.objects.grainL:getGovernorBudget()
+  t.sharedName = self.sharedName
+  return t
+end
+
+function ManualGrainDelay:deserialize(t)
+  if t.governorBudget then
+    self:setGovernorBudget(t.governorBudget)
+  end
+  Unit.deserialize(self, t)
+  self:updateMipMap()
+  if hasSharedBuffers and t.sharedName then
+    self:setSharedBuffer(t.sharedName)
+  end
+end
+
+function ManualGrainDelay:onRemove()
+  if hasSharedBuffers then
+    SharedBuffers.unwatch(self)
+  end
+  Unit.onRemove(self)
+end
+
 -- function ManualGrainDelay:onLoadFinished()
 --   self:setMaxDelay(2.0)
 -- end
@@ -0,0 +1,156 @@
+local app = app
+local YBase = require "fdelay.YBase"
+local libfdelay = require "fdelay.libfdelay"
+local libcore = require "core.libcore"
+local Class = require "Base.Class"
+local Unit = require "Unit"
+local GainBias = require "Unit.ViewControl.GainBias"
+local Pitch = require "Unit.ViewControl.Pitch"
+local Encoder = require "Encoder"
+local OptionControl = require "Unit.MenuControl.OptionControl"
+local MenuHeader = require "Unit.MenuControl.Header"
+
+local PitchShifter = Class {}
+PitchShifter:include(YBase)
+
+function PitchShifter:init(args)
+  args.title = "Pitch Shifter"
+  args.mnemonic = "PS"
+  Unit.init(self, args)
+  YBase.init(self, args)
+end
+
+function PitchShifter:onLoadGraph(channelCount)
+  local shiftL = self:addObject("shiftL", libfdelay.PitchShifter())
+
+  local window = self:createAdapterControl("window")
+  tie(shiftL, "Window", window, "Out")
+
+  local speed = self:createControl("speed", app.GainBias())
+  local tune = self:createControl("tune", app.ConstantOffset())
+  local pitch = self:addObject("pitch", libcore.VoltPerOctave())
+  local multiply = self:addObject("multiply", app.Multiply())
+  local clipper = self:addObject("clipper", libcore.Clipper())
+  clipper:setMaximum(4.0)
+  clipper:setMinimum(0.25)
+
+  -- Pitch and Linear FM
+  connect(tune, "Out", pitch, "In")
+  connect(pitch, "Out", multiply, "Left")
+  connect(speed, "Out", multiply, "Right")
+  connect(multiply, "Out", clipper, "In")
+  connect(clipper, "Out", shiftL, "Speed")
+
+  local xfade = self:addObject("xfade", app.StereoCrossFade())
+  local fader = self:createControl("fader", app.GainBias())
+  connect(fader, "Out", xfade, "Fade")
+
+  connect(self, "In1", shiftL, "In")
+  connect(self, "In1", xfade, "Left B")
+  connect(shiftL, "Out", xfade, "Left A")
+  connect(xfade, "Left Out", self, "Out1")
+
+  if channelCount == 2 then
+    local shiftR = self:addObject("shiftR", libfdelay.PitchShifter())
+    tie(shiftR, "Window", window, "Out")
+    connect(clipper, "Out", shiftR, "Speed")
+
+    connect(self, "In2", shiftR, "In")
+    connect(self, "In2", xfade, "Right B")
+    connect(shiftR, "Out", xfade, "Right A")
+    connect(xfade, "Right Out", self, "Out2")
+  end
+end
+
+local menu = {
+  "voicesHeader",
+  "voices"
+}
+
+function PitchShifter:onShowMenu(objects, branches)
+  local controls = {}
+
+  controls.voicesHeader = MenuHeader {
+    description = "Overlapping grains"
+  }
+
+  controls.voices = OptionControl {
+    description = "Voices",
+    option = objects.shiftL:getOption("Voices"),
+    choices = {
+      "2",
+      "3",
+      "4"
+    },
+    callback = function(choice)
+      if objects.shiftR then
+        objects.shiftR:setOptionValue("Voices", choice)
+      end
+    end
+  }
+
+  return controls, menu
+end
+
+local function windowMap()
+  local map = app.LinearDialMap(0.01, 0.25)
+  map:setSteps(0.01, 0.001, 0.001, 0.001)
+  return map
+end
+
+function PitchShifter:onLoadViews(objects, branches)
+  local controls = {}
+  local views = {
+    expanded = {
+      "pitch",
+      "speed",
+      "window",
+      "wet"
+    },
+    collapsed = {}
+  }
+
+  controls.pitch = Pitch {
+    button = "V/oct",
+    description = "V/oct",
+    branch = branches.tune,
+    offset = objects.tune,
+    range = objects.tuneRange
+  }
+
+  controls.speed = GainBias {
+    button = "ratio",
+    branch = branches.speed,
+    description = "Pitch Ratio",
+    gainbias = objects.speed,
+    range = objects.speedRange,
+    biasMap = Encoder.getMap("speed"),
+    biasUnits = app.unitNone,
+    initialBias = 1.0
+  }
+
+  controls.window = GainBias {
+    button = "window",
+    description = "Window",
+    branch = branches.window,
+    gainbias = objects.window,
+    range = objects.window,
+    biasMap = windowMap(),
+    biasUnits = app.unitSecs,
+    initialBias = 0.05
+  }
+
+  controls.wet = GainBias {
+    button = "wet",
+    branch = branches.fader,
+    description = "Wet/Dry",
+    gainbias = objects.fader,
+    range = objects.faderRange,
+    biasMap = Encoder.getMap("unit"),
+    initialBias = 1.0
+  }
+
+  return controls, views
+end
+
+return PitchShifter
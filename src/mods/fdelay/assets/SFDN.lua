@@ -31,6 +31,7 @@ local Class = require "Base.Class"
 local Unit = require "Unit"
 local Encoder = require "Encoder"
 local libcore = require "core.libcore"
+local libfdelay = require "fdelay.libfdelay"
 local Gate = require "Unit.ViewControl.Gate"
 local GainBias = require "Unit.ViewControl.GainBias"
 local Utils = require "Utils"
@@ -56,146 +57,122 @@ function SFDN:init(args)
   YBase.init(self, args)
 end
 
-function SFDN:onLoadGraph(channelCount)
-  local inLevelAdapter = self:createAdapterControl("inLevelAdapter")
-  local inLevelL = self:addObject("inLevelL", app.ConstantGain())
-  tie(inLevelL, "Gain", inLevelAdapter, "Out")
-  local inLevelR = self:addObject("inLevelR", app.ConstantGain())
-  tie(inLevelR, "Gain", inLevelAdapter, "Out")
+-- Fixed part of the network, shared by all instances.
+local graph = {
+  objects = {
+    {"inLevelL", app.ConstantGain},
+    {"inLevelR", app.ConstantGain},
+    {"xfade", app.StereoCrossFade},
+    {"inLMix", app.Sum},
+    {"inRMix", app.Sum},
+    {"delayScale1", app.Constant, set = {Value = 1.0}},
+    {"delayScale2", app.Constant},
+    {"delayScale3", app.Constant},
+    {"delayScale4", app.Constant},
+    {"diffuser", libfdelay.Diffuser},
+    {"matrix", libfdelay.FeedbackMatrix},
+    {"half", app.Constant, set = {Value = 0.5}},
+    {"fdnMixL", app.Sum},
+    {"fdnMixR", app.Sum}
+  },
+  connections = {
+    {"fader", "Out", "xfade", "Fade"},
+
+    {"inLevelL", "Out", "diffuser", "Left In"},
+    {"inLevelR", "Out", "diffuser", "Right In"},
+    {"diffuser", "Left Out", "inLMix", "Left"},
+    {"diffuser", "Right Out", "inRMix", "Left"},
+    {"inLMix", "Out", "eq1", "In"},
+    {"inRMix", "Out", "eq2", "In"},
+
+    {"eq1", "Out", "delay12", "Left In"},
+    {"eq2", "Out", "delay12", "Right In"},
+    {"eq3", "Out", "delay34", "Left In"},
+    {"eq4", "Out", "delay34", "Right In"},
+
+    {"delay12", "Left Out", "matrix", "In1"},
+    {"delay12", "Right Out", "matrix", "In2"},
+    {"delay34", "Left Out", "matrix", "In3"},
+    {"delay34", "Right Out", "matrix", "In4"},
+
+    {"matrix", "Out1", "inLMix", "Right"},
+    {"matrix", "Out2", "eq3", "In"},
+    {"matrix", "Out3", "inRMix", "Right"},
+    {"matrix", "Out4", "eq4", "In"},
+
+    {"matrix", "Out1", "fdnMixL", "Left"},
+    {"matrix", "Out2", "fdnMixR", "Left"},
+    {"matrix", "Out3", "fdnMixL", "Right"},
+    {"matrix", "Out4", "fdnMixR", "Right"},
+
+    {"fdnMixL", "Out", "xfade", "Left A"},
+    {"fdnMixR", "Out", "xfade", "Right A"},
+
+    {"self", "In1", "xfade", "Left B"},
+    {"xfade", "Left Out", "self", "Out1"}
+  },
+  ties = {
+    {"inLevelL", "Gain", "inLevelAdapter", "Out"},
+    {"inLevelR", "Gain", "inLevelAdapter", "Out"},
+    {"diffuser", "Diffusion", "diffusionAdapter", "Out"}
+  }
+}
 
-  local xfade = self:addObject("xfade", app.StereoCrossFade())
-  local fader = self:createControl("fader", app.GainBias())
-  connect(fader, "Out", xfade, "Fade")
+local monoGraph = {
+  connections = {
+    {"self", "In1", "inLevelL", "In"},
+    {"self", "In1", "inLevelR", "In"}
+  }
+}
+
+local stereoGraph = {
+  connections = {
+    {"self", "In1", "inLevelL", "In"},
+    {"self", "In2", "inLevelR", "In"},
+    {"self", "In2", "xfade", "Right B"},
+    {"xfade", "Right Out", "self", "Out2"}
+  }
+}
 
-  local inLMix = self:addObject("inLMix", app.Sum())
-  local inRMix = self:addObject("inRMix", app.Sum())
+function SFDN:onLoadGraph(channelCount)
+  self:createAdapterControl("inLevelAdapter")
+  self:createAdapterControl("diffusionAdapter")
+  self:createControl("fader", app.GainBias())
 
   local tone = self:createControl("tone", app.GainBias())
   local eqHigh = self:createEqHighControl(tone)
   local eqMid = self:createEqMidControl()
   local eqLow = self:createEqLowControl(tone)
 
-  local eq1 = self:createEq("eq1", eqHigh, eqMid, eqLow)
-  local eq2 = self:createEq("eq2", eqHigh, eqMid, eqLow)
-  local eq3 = self:createEq("eq3", eqHigh, eqMid, eqLow)
-  local eq4 = self:createEq("eq4", eqHigh, eqMid, eqLow)
-
-  local delay12 = self:addObject("delay12", libcore.Delay(2))
-  delay12:allocateTimeUpTo(self.delayMax + 0.1)
-  local delay34 = self:addObject("delay34", libcore.Delay(2))
-  delay34:allocateTimeUpTo(self.delayMax + 0.1)
+  self:createEq("eq1", eqHigh, eqMid, eqLow)
+  self:createEq("eq2", eqHigh, eqMid, eqLow)
+  self:createEq("eq3", eqHigh, eqMid, eqLow)
+  self:createEq("eq4", eqHigh, eqMid, eqLow)
 
+  local delay12 = self:createLazyDelay("delay12", libfdelay.LazyStereoDelay(self.delayMax + 0.1), self.refl2 / self.refl1)
+  local delay34 = self:createLazyDelay("delay34", libfdelay.LazyStereoDelay(self.delayMax + 0.1), self.refl4 / self.refl1)
   local delayAdapter = self:createAdapterControl("delayAdapter")
-  local delayScale1 = self:addObject("delayScale1", app.Constant())
-  delayScale1:hardSet("Value", 1.0)
-  local delayScale2 = self:addObject("delayScale2", app.Constant())
-  delayScale2:hardSet("Value", self.refl2 / self.refl1)
-  local delayScale3 = self:addObject("delayScale3", app.Constant())
-  delayScale3:hardSet("Value", self.refl3 / self.refl1)
-  local delayScale4 = self:addObject("delayScale4", app.Constant())
-  delayScale4:hardSet("Value", self.refl4 / self.refl1)
-
-  tie(delay12, "Left Delay", "*", delayScale1, "Value", delayAdapter, "Out")
-  tie(delay12, "Right Delay", "*", delayScale2, "Value", delayAdapter, "Out")
-  tie(delay34, "Left Delay", "*", delayScale3, "Value", delayAdapter, "Out")
-  tie(delay34, "Right Delay", "*", delayScale4, "Value",  delayAdapter, "Out")
-
-  local dif11 = self:addObject("dif11", app.Sum())
-  local dif11r = self:negative("dif11", dif11)
-  local sum12 = self:addObject("sum12", app.Sum())
-  local sum12r = self:positive("sum12", sum12)
-  local dif13 = self:addObject("dif13", app.Sum())
-  local dif13r = self:negative("dif13", dif13)
-  local sum14 = self:addObject("sum14", app.Sum())
-  local sum14r = self:positive("sum14", sum14)
-
-  local dif21 = self:addObject("dif21", app.Sum())
-  local dif21r = self:negative("dif21", dif21)
-  local sum22 = self:addObject("sum22", app.Sum())
-  local sum22r = self:positive("sum22", sum22)
-  local dif23 = self:addObject("dif23", app.Sum())
-  local dif23r = self:negative("dif23", dif23)
-  local sum24 = self:addObject("sum24", app.Sum())
-  local sum24r = self:positive("sum24", sum24)
-
   local feedbackAdapter = self:createAdapterControl("feedbackAdapter")
-  local half = self:addObject("half", app.Constant())
-  half:hardSet("Value", 0.5)
-  local feedback1 = self:addObject("feedback1", app.ConstantGain())
-  feedback1:setClampInDecibels(-23.9)
-  tie(feedback1, "Gain", "*", half, "Value", feedbackAdapter, "Out")
-  local feedback2 = self:addObject("feedback2", app.ConstantGain())
-  feedback2:setClampInDecibels(-23.9)
-  tie(feedback2, "Gain", "*", half, "Value", feedbackAdapter, "Out")
-  local feedback3 = self:addObject("feedback3", app.ConstantGain())
-  feedback3:setClampInDecibels(-23.9)
-  tie(feedback3, "Gain", "*", half, "Value", feedbackAdapter, "Out")
-  local feedback4 = self:addObject("feedback4", app.ConstantGain())
-  feedback4:setClampInDecibels(-23.9)
-  tie(feedback4, "Gain", "*", half, "Value", feedbackAdapter, "Out")
-
-  local fdnMixL = self:addObject("fdnMixL", app.Sum())
-  local fdnMixR = self:addObject("fdnMixR", app.Sum())
 
+  self:buildGraph(graph)
   if channelCount == 2 then
-    connect(self, "In1", inLevelL, "In")
-    connect(self, "In2", inLevelR, "In")
+    self:buildGraph(stereoGraph)
   else
-    connect(self, "In1", inLevelL, "In")
-    connect(self, "In1", inLevelR, "In")
-  end
-  connect(inLevelL, "Out", inLMix, "Left")
-  connect(inLevelR, "Out", inRMix, "Left")
-  connect(inLMix, "Out", eq1, "In")
-  connect(inRMix, "Out", eq2, "In")
-
-  connect(eq1, "Out", delay12, "Left In")
-  connect(eq2, "Out", delay12, "Right In")
-  connect(eq3, "Out", delay34, "Left In")
-  connect(eq4, "Out", delay34, "Right In")
-
-  connect(delay12, "Left Out", dif11, "Left")
-  connect(delay12, "Left Out", sum12, "Left")
-  connect(delay12, "Right Out", dif11r, "In")
-  connect(delay12, "Right Out", sum12r, "In")
-  connect(delay34, "Left Out", dif13, "Left")
-  connect(delay34, "Left Out", sum14, "Left")
-  connect(delay34, "Right Out", dif13r, "In")
-  connect(delay34, "Right Out", sum14r, "In")
-
-  connect(dif11, "Out", dif21, "Left")
-  connect(dif11, "Out", sum22, "Left")
-  connect(sum12, "Out", dif23, "Left")
-  connect(sum12, "Out", sum24, "Left")
-  connect(dif13, "Out", dif21r, "In")
-  connect(dif13, "Out", sum22r, "In")
-  connect(sum14, "Out", dif23r, "In")
-  connect(sum14, "Out", sum24r, "In")
-
-  connect(dif21, "Out", feedback1, "In")
-  connect(sum22, "Out", feedback2, "In")
-  connect(dif23, "Out", feedback3, "In")
-  connect(sum24, "Out", feedback4, "In")
-
-  connect(feedback1, "Out", inLMix, "Right")
-  connect(feedback2, "Out", eq3, "In")
-  connect(feedback3, "Out", inRMix, "Right")
-  connect(feedback4, "Out", eq4, "In")
-
-  connect(feedback1, "Out", fdnMixL, "Left")
-  connect(feedback2, "Out", fdnMixR, "Left")
-  connect(feedback3, "Out", fdnMixL, "Right")
-  connect(feedback4, "Out", fdnMixR, "Right")
-
-  connect(fdnMixL, "Out", xfade, "Left A")
-  connect(fdnMixR, "Out", xfade, "Right A")
-
-  connect(self, "In1", xfade, "Left B")
-  connect(xfade, "Left Out", self, "Out1")
-  if channelCount == 2 then
-    connect(self, "In2", xfade, "Right B")
-    connect(xfade, "Right Out", self, "Out2")
+    self:buildGraph(monoGraph)
   end
+
+  local objects = self.objects
+  objects.delayScale2:hardSet("Value", self.refl2 / self.refl1)
+  objects.delayScale3:hardSet("Value", self.refl3 / self.refl1)
+  objects.delayScale4:hardSet("Value", self.refl4 / self.refl1)
+
+  tie(delay12, "Left Delay", "*", objects.delayScale1, "Value", delayAdapter, "Out")
+  tie(delay12, "Right Delay", "*", objects.delayScale2, "Value", delayAdapter, "Out")
+  tie(delay34, "Left Delay", "*", objects.delayScale3, "Value", delayAdapter, "Out")
+  tie(delay34, "Right Delay", "*", objects.delayScale4, "Value",  delayAdapter, "Out")
+
+  objects.matrix:setClampInDecibels(-23.9)
+  tie(objects.matrix, "Gain", "*", objects.half, "Value", feedbackAdapter, "Out")
 end
 
 local function timeMap(max, n)
@@ -214,7 +191,7 @@ end
 function SFDN:onLoadViews(objects, branches)
   local controls = {}
   local views = {
-    expanded = {"delay", "feedback", "tone", "input", "wet"},
+    expanded = {"delay", "feedback", "tone", "diffuse", "input", "wet"},
     collapsed = {}
   }
 
@@ -250,6 +227,16 @@ function SFDN:onLoadViews(objects, branches)
     biasMap = Encoder.getMap("[-1,1]")
   }
 
+  controls.diffuse = GainBias {
+    button = "diffuse",
+    description = "Input Diffusion",
+    branch = branches.diffusionAdapter,
+    gainbias = objects.diffusionAdapter,
+    range = objects.diffusionAdapter,
+    biasMap = Encoder.getMap("unit"),
+    initialBias = 0.6
+  }
+
   controls.input = GainBias {
     button = "input",
     description = "FDN Input Level",
@@ -273,9 +260,13 @@ function SFDN:onLoadViews(objects, branches)
   return controls, views
 end
 
+function SFDN:deserialize(t)
+  Unit.deserialize(self, t)
+  self:reserveLazyDelays(self.objects.delayAdapter:getParameter("Bias"):target())
+end
+
 function SFDN:onRemove()
-  self.objects.delay12:deallocate()
-  self.objects.delay34:deallocate()
+  self:removeLazyDelays()
   Unit.onRemove(self)
 end
 
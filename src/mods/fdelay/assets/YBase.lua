@@ -24,6 +24,8 @@
 local Class = require "Base.Class"
 local Unit = require "Unit"
 local libcore = require "core.libcore"
+local libfdelay = require "fdelay.libfdelay"
+local Timer = require "Timer"
 
 local YBase = Class {}
 YBase:include(Unit)
@@ -32,20 +34,142 @@ function YBase:init(args)
   Unit.init(self, args)
 end
 
+-- Graph specifications are plain tables, usually defined once per module:
+--
+--   {
+--     objects = {{name, constructor, args..., set = {param = value}}, ...},
+--     connections = {{from, outlet, to, inlet}, ...},
+--     ties = {{to, parameter, from, parameter}, ...}
+--   }
+--
+-- Objects are created with constructor(args...). In connections and ties,
+-- "self" refers to the unit and other names may refer to objects created
+-- before the graph was built. A specification is checked the first time it
+-- is used, later instantiations skip the check.
+local function validateGraph(spec)
+  local names = {}
+  for i, o in ipairs(spec.objects or {}) do
+    if type(o[1]) ~= "string" or o[2] == nil then
+      error(string.format("graph: object %d needs a name and a constructor", i))
+    end
+    if names[o[1]] or o[1] == "self" then
+      error(string.format("graph: object '%s' is defined twice", o[1]))
+    end
+    names[o[1]] = true
+  end
+  for i, c in ipairs(spec.connections or {}) do
+    if #c ~= 4 then
+      error(string.format("graph: connection %d needs 4 fields", i))
+    end
+  end
+  for i, t in ipairs(spec.ties or {}) do
+    if #t ~= 4 then
+      error(string.format("graph: tie %d needs 4 fields", i))
+    end
+  end
+  spec.validated = true
+end
+
+function YBase:buildGraph(spec)
+  if not spec.validated then
+    validateGraph(spec)
+  end
+
+  local objects = self.objects
+  local function lookup(name)
+    if name == "self" then
+      return self
+    end
+    local object = objects[name]
+    if object == nil then
+      error(string.format("graph: unknown object '%s'", name))
+    end
+    return object
+  end
+
+  for _, o in ipairs(spec.objects or {}) do
+    local object = self:addObject(o[1], o[2](table.unpack(o, 3)))
+    if o.set then
+      for parameter, value in pairs(o.set) do
+        object:hardSet(parameter, value)
+      end
+    end
+  end
+  for _, c in ipairs(spec.connections or {}) do
+    connect(lookup(c[1]), c[2], lookup(c[3]), c[4])
+  end
+  for _, t in ipairs(spec.ties or {}) do
+    tie(lookup(t[1]), t[2], lookup(t[3]), t[4])
+  end
+end
+
 function YBase:createControl(name, type)
   local control = self:addObject(name, type)
-  local controlRange = self:addObject(name .. "Range", app.MinMax())
-  connect(control, "Out", controlRange, "In")
+  self:createRange(name, control)
   self:addMonoBranch(name, control, "In", control, "Out")
   return control
 end
 
+-- Adds <name>Range for the view of a control. All ranges of a unit are
+-- measured by one RangeMeter, falling back to a MinMax when it is full.
+function YBase:createRange(name, control)
+  local meter = self.objects.rangeMeter or self:addObject("rangeMeter", libfdelay.RangeMeter())
+  local tap = meter:watch(name)
+  if tap then
+    connect(control, "Out", meter, name)
+    return self:addObject(name .. "Range", tap)
+  end
+  local range = self:addObject(name .. "Range", app.MinMax())
+  connect(control, "Out", range, "In")
+  return range
+end
+
 function YBase:createAdapterControl(name)
   local adapter = self:addObject(name, app.ParameterAdapter())
   self:addMonoBranch(name, adapter, "In", adapter, "Out")
   return adapter
 end
 
+-- Delays from libfdelay that only allocate the memory their current delay
+-- needs. scale maps the unit's delay control onto the delay of this object.
+-- The first one starts a UI timer that stages and frees their memory.
+function YBase:createLazyDelay(name, delay, scale)
+  local object = self:addObject(name, delay)
+  if self.lazyDelays == nil then
+    self.lazyDelays = {}
+    self.lazyDelayTimer = Timer.every(0.1, function()
+      self:maintainLazyDelays()
+    end)
+  end
+  self.lazyDelays[#self.lazyDelays + 1] = {
+    object = object,
+    scale = scale or 1.0
+  }
+  return object
+end
+
+function YBase:reserveLazyDelays(secs)
+  for _, delay in ipairs(self.lazyDelays or {}) do
+    delay.object:reserve(secs * delay.scale)
+  end
+end
+
+function YBase:maintainLazyDelays()
+  for _, delay in ipairs(self.lazyDelays or {}) do
+    delay.object:maintain()
+  end
+end
+
+function YBase:removeLazyDelays()
+  if self.lazyDelayTimer then
+    Timer.cancel(self.lazyDelayTimer)
+    self.lazyDelayTimer = nil
+  end
+  for _, delay in ipairs(self.lazyDelays or {}) do
+    delay.object:deallocate()
+  end
+end
+
 function YBase:createEq(name, high, mid, low)
   local eq = self:addObject(name, libcore.Equalizer3())
   eq:hardSet("Low Freq", 3000.0)
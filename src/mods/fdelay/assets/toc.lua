@@ -52,6 +52,18 @@ return {
       title = "Manual Grain Delay",
       moduleName = "ManualGrainDelay",
       keywords = "delay, effect, pitch"
+    }, {
+      title = "Grain Cloud",
+      moduleName = "GrainCloud",
+      keywords = "delay, effect, pitch"
+    }, {
+      title = "Pitch Shifter",
+      moduleName = "PitchShifter",
+      keywords = "effect, pitch"
+    }, {
+      title = "Convolution",
+      moduleName = "Convolution",
+      keywords = "reverb, effect"
     }
   }
 }
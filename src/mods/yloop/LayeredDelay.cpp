@@ -0,0 +1,441 @@
+#include <LayeredDelay.h>
+#include <AllocationAudit.h>
+#include <od/config.h>
+#include <hal/ops.h>
+#include <string.h>
+
+namespace yloop
+{
+  // How long after a falling edge on Record a shorter delay still counts as
+  // the end of a take. YLoop's delay follows Once through a tie, which lags
+  // the gate by a frame.
+  static const int maxEdgeFrames = 2;
+
+  LayeredDelay::LayeredDelay()
+  {
+    addInput(mLeftInput);
+    addInput(mRightInput);
+    addInput(mFeedback);
+    addInput(mRecord);
+    addOutput(mLeftOutput);
+    addOutput(mRightOutput);
+    addParameter(mLeftDelay);
+    addParameter(mRightDelay);
+  }
+
+  LayeredDelay::~LayeredDelay()
+  {
+    deallocate();
+  }
+
+  bool LayeredDelay::allocate(float maxSecs, float undoSecs)
+  {
+    deallocate();
+
+    mPageCount = (int)(MAX(0.0f, maxSecs) * globalConfig.sampleRate) / mPageSize + 1;
+    mCapacity = mPageCount * mPageSize;
+    int spare = (int)(MAX(0.0f, undoSecs) * globalConfig.sampleRate) / mPageSize;
+    int copies = mPageCount + spare;
+
+    mPool = new common::SharedBuffer();
+    mPool->attach();
+    if (!mPool->allocate(2, copies * mPageSize))
+    {
+      deallocate();
+      return false;
+    }
+    mShared = spare == 0;
+    mTable.resize(mPageCount);
+    for (int i = 0; i < mPageCount; i++)
+    {
+      mTable[i] = i;
+    }
+    mFreeCopies.clear();
+    mFreeCopies.reserve(copies);
+    for (int i = copies - 1; i >= mPageCount; i--)
+    {
+      mFreeCopies.push_back(i);
+    }
+    mTouched.assign(mPageCount, 0);
+    mEntries.resize((size_t)mMaxLayers * mPageCount);
+
+    mOldest = 0;
+    mUndoDepth = 0;
+    mRedoDepth = 0;
+    mRecording = false;
+    mGate = false;
+    mLeft = Loop();
+    mRight = Loop();
+    mTakeAge = -1;
+    mHead = 0;
+    mFallAge = -1;
+    mRequests = 0;
+    mPublishedUndoDepth = 0;
+    mPublishedRedoDepth = 0;
+    mMaxDelayInSeconds = mCapacity * globalConfig.samplePeriod;
+    mEnabled = true;
+    return true;
+  }
+
+  void LayeredDelay::deallocate()
+  {
+    mEnabled = false;
+    if (mPool)
+    {
+      // readers of the shared buffer hold their own reference
+      mPool->release();
+      mPool = 0;
+    }
+    mShared = false;
+    mFreeCopies = std::vector<int>();
+    mTable = std::vector<int>();
+    mTouched = std::vector<uint8_t>();
+    mEntries = std::vector<Entry>();
+    mPageCount = 0;
+    mCapacity = 0;
+    mMaxDelayInSeconds = 0.0f;
+  }
+
+  float LayeredDelay::getMaxDelay()
+  {
+    return mMaxDelayInSeconds;
+  }
+
+  void LayeredDelay::undo()
+  {
+    mRequests++;
+  }
+
+  void LayeredDelay::redo()
+  {
+    mRequests--;
+  }
+
+  int LayeredDelay::getUndoDepth()
+  {
+    return mPublishedUndoDepth;
+  }
+
+  int LayeredDelay::getRedoDepth()
+  {
+    return mPublishedRedoDepth;
+  }
+
+  common::SharedBuffer *LayeredDelay::getSharedBuffer()
+  {
+    return mShared ? mPool : 0;
+  }
+
+  inline float *LayeredDelay::pageData(int copy)
+  {
+    return mPool->mpData + (size_t)copy * mPageSize * 2;
+  }
+
+  inline LayeredDelay::Entry *LayeredDelay::entries(int layer)
+  {
+    return mEntries.data() + (size_t)layer * mPageCount;
+  }
+
+  void LayeredDelay::freeLayer(int layer)
+  {
+    // the copies held by a layer are not in the page table
+    Entry *e = entries(layer);
+    for (int i = 0; i < mLayers[layer].count; i++)
+    {
+      mFreeCopies.push_back(e[i].copy);
+    }
+    mLayers[layer].count = 0;
+  }
+
+  void LayeredDelay::swapLayer(int layer)
+  {
+    Entry *e = entries(layer);
+    for (int i = 0; i < mLayers[layer].count; i++)
+    {
+      int copy = mTable[e[i].page];
+      mTable[e[i].page] = e[i].copy;
+      e[i].copy = copy;
+    }
+  }
+
+  void LayeredDelay::beginLayer()
+  {
+    // a new layer forgets everything that was undone
+    for (int i = 0; i < mRedoDepth; i++)
+    {
+      freeLayer((mOldest + mUndoDepth + i) % mMaxLayers);
+    }
+    mRedoDepth = 0;
+
+    if (mUndoDepth == mMaxLayers)
+    {
+      freeLayer(mOldest);
+      mOldest = (mOldest + 1) % mMaxLayers;
+      mUndoDepth--;
+    }
+
+    Layer &layer = mLayers[(mOldest + mUndoDepth) % mMaxLayers];
+    layer.count = 0;
+    layer.complete = true;
+    mUndoDepth++;
+    memset(mTouched.data(), 0, mTouched.size());
+    mRecording = true;
+  }
+
+  void LayeredDelay::copyOnWrite(int page)
+  {
+    if (mTouched[page])
+    {
+      return;
+    }
+    mTouched[page] = 1;
+
+    // make room by forgetting the oldest layers, never the current one
+    while (mFreeCopies.empty() && mUndoDepth > 1)
+    {
+      freeLayer(mOldest);
+      mOldest = (mOldest + 1) % mMaxLayers;
+      mUndoDepth--;
+    }
+
+    int current = (mOldest + mUndoDepth - 1) % mMaxLayers;
+    Layer &layer = mLayers[current];
+    if (mFreeCopies.empty())
+    {
+      // out of pages, this layer can no longer be undone
+      layer.complete = false;
+      return;
+    }
+
+    int copy = mFreeCopies.back();
+    mFreeCopies.pop_back();
+    memcpy(pageData(copy), pageData(mTable[page]), sizeof(float) * mPageSize * 2);
+    Entry &entry = entries(current)[layer.count++];
+    entry.page = page;
+    entry.copy = mTable[page];
+    mTable[page] = copy;
+  }
+
+  void LayeredDelay::applyRequests()
+  {
+    int requests = mRequests.exchange(0);
+    while (requests > 0 && mUndoDepth > 0)
+    {
+      Layer &layer = mLayers[(mOldest + mUndoDepth - 1) % mMaxLayers];
+      if (!layer.complete)
+      {
+        break;
+      }
+      swapLayer((mOldest + mUndoDepth - 1) % mMaxLayers);
+      mUndoDepth--;
+      mRedoDepth++;
+      mRecording = false;
+      requests--;
+    }
+    while (requests < 0 && mRedoDepth > 0)
+    {
+      swapLayer((mOldest + mUndoDepth) % mMaxLayers);
+      mUndoDepth++;
+      mRedoDepth--;
+      mRecording = false;
+      requests++;
+    }
+    mPublishedUndoDepth = mUndoDepth;
+    mPublishedRedoDepth = mRedoDepth;
+  }
+
+  inline int LayeredDelay::position(const Loop &loop)
+  {
+    int i = loop.origin + loop.offset;
+    return i < mCapacity ? i : i - mCapacity;
+  }
+
+  void LayeredDelay::resize(Loop &loop, int length)
+  {
+    // a shorter loop keeps its start and wraps as if it had always been
+    // this long
+    loop.length = length;
+    if (loop.offset >= length)
+    {
+      loop.offset %= length;
+    }
+  }
+
+  void LayeredDelay::anchor(Loop &loop, int elapsed)
+  {
+    // the loop now starts at the edge, which was written elapsed samples ago
+    loop.origin = loop.edge;
+    loop.offset = MIN(elapsed, loop.length - 1);
+  }
+
+  void LayeredDelay::processShared(float *leftIn, float *rightIn, float *feedback, float *record,
+                                   float *leftOut, float *rightOut, int leftLength, int rightLength)
+  {
+    // A shorter delay right after a falling edge ends a take. What was
+    // written since the edge is dropped, so the next write follows the last
+    // sample of the take and the read lands on its first.
+    if (leftLength < mLeft.length && mFallAge >= 0)
+    {
+      mHead -= mFallAge;
+      if (mHead < 0)
+      {
+        mHead += mCapacity;
+      }
+      mFallAge = -1;
+    }
+    mLeft.length = leftLength;
+
+    // the page table never changes here, so the pool is addressed directly
+    float *data = mPool->mpData;
+    for (int i = 0; i < FRAMELENGTH; i++)
+    {
+      bool gate = record[i] > 0.0f;
+      if (!gate && mGate)
+      {
+        mFallAge = 0;
+      }
+      mGate = gate;
+
+      int left = mHead - leftLength;
+      if (left < 0)
+      {
+        left += mCapacity;
+      }
+      int right = mHead - rightLength;
+      if (right < 0)
+      {
+        right += mCapacity;
+      }
+
+      float l = data[2 * left];
+      float r = data[2 * right + 1];
+      leftOut[i] = l;
+      rightOut[i] = r;
+      data[2 * mHead] = leftIn[i] + feedback[i] * l;
+      data[2 * mHead + 1] = rightIn[i] + feedback[i] * r;
+
+      if (++mHead == mCapacity)
+      {
+        mHead = 0;
+      }
+      if (mFallAge >= 0 && ++mFallAge > maxEdgeFrames * FRAMELENGTH)
+      {
+        mFallAge = -1;
+      }
+    }
+
+    mPool->publish(mHead, leftLength);
+  }
+
+  void LayeredDelay::process()
+  {
+    AUDIT_PROCESS();
+    float *leftIn = mLeftInput.buffer();
+    float *rightIn = mRightInput.buffer();
+    float *feedback = mFeedback.buffer();
+    float *record = mRecord.buffer();
+    float *leftOut = mLeftOutput.buffer();
+    float *rightOut = mRightOutput.buffer();
+
+    if (!mEnabled)
+    {
+      memset(leftOut, 0, sizeof(float) * FRAMELENGTH);
+      memset(rightOut, 0, sizeof(float) * FRAMELENGTH);
+      return;
+    }
+
+    int leftLength = CLAMP(1, mCapacity, (int)(mLeftDelay.value() * globalConfig.sampleRate + 0.5f));
+    int rightLength = CLAMP(1, mCapacity, (int)(mRightDelay.value() * globalConfig.sampleRate + 0.5f));
+
+    if (mShared)
+    {
+      processShared(leftIn, rightIn, feedback, record, leftOut, rightOut, leftLength, rightLength);
+      return;
+    }
+
+    applyRequests();
+
+    // a longer delay while a take is held starts the loop at its edge
+    bool grew = leftLength > mLeft.length;
+    if (grew && mTakeAge >= 0)
+    {
+      anchor(mLeft, mTakeAge);
+      anchor(mRight, mTakeAge);
+      mTakeAge = -1;
+    }
+    resize(mLeft, leftLength);
+    resize(mRight, rightLength);
+
+    for (int i = 0; i < FRAMELENGTH; i++)
+    {
+      // Only a rising edge starts a layer. An undo or redo while Record is
+      // held closes the layer, it does not start a new one.
+      bool gate = record[i] > 0.0f;
+      if (gate && !mGate)
+      {
+        beginLayer();
+        mLeft.edge = position(mLeft);
+        mRight.edge = position(mRight);
+        if (grew)
+        {
+          anchor(mLeft, 0);
+          anchor(mRight, 0);
+          mTakeAge = -1;
+        }
+        else
+        {
+          mTakeAge = 0;
+        }
+      }
+      else if (!gate)
+      {
+        mTakeAge = -1;
+      }
+      mGate = gate;
+
+      int left = position(mLeft);
+      int right = position(mRight);
+      int leftPage = left >> mPageShift;
+      int rightPage = right >> mPageShift;
+      float *l = pageData(mTable[leftPage]) + 2 * (left & mPageMask);
+      float *r = pageData(mTable[rightPage]) + 2 * (right & mPageMask) + 1;
+      float lx = *l;
+      float rx = *r;
+      float ly = leftIn[i] + feedback[i] * lx;
+      float ry = rightIn[i] + feedback[i] * rx;
+
+      // the open layer keeps each page as it was before its first change
+      if (mRecording && ((ly != lx && !mTouched[leftPage]) || (ry != rx && !mTouched[rightPage])))
+      {
+        if (ly != lx)
+        {
+          copyOnWrite(leftPage);
+        }
+        if (ry != rx)
+        {
+          copyOnWrite(rightPage);
+        }
+        l = pageData(mTable[leftPage]) + 2 * (left & mPageMask);
+        r = pageData(mTable[rightPage]) + 2 * (right & mPageMask) + 1;
+      }
+
+      leftOut[i] = lx;
+      rightOut[i] = rx;
+      *l = ly;
+      *r = ry;
+
+      if (++mLeft.offset == mLeft.length)
+      {
+        mLeft.offset = 0;
+      }
+      if (++mRight.offset == mRight.length)
+      {
+        mRight.offset = 0;
+      }
+      if (mTakeAge >= 0)
+      {
+        mTakeAge++;
+      }
+    }
+  }
+} /* namespace yloop */
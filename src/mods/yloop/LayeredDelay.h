@@ -0,0 +1,147 @@
+#pragma once
+
+#include <od/objects/Object.h>
+#include <SharedBuffer.h>
+#include <atomic>
+#include <stdint.h>
+#include <vector>
+
+namespace yloop
+{
+  // Stereo feedback loop with the ports of libcore.Delay plus Record. Each
+  // channel reads and overwrites one position that wraps at its delay, which
+  // keeps every point of the loop at a fixed place in memory. It sounds like
+  // a delay line while the delay holds still. A changed delay (YLoop's Size
+  // or R/L) does not replay the most recent audio like a delay line would:
+  // the loop keeps its start and plays the first part of what it holds.
+  //
+  // A loop starts where the take that set its length started. When the delay
+  // grows while Record is still held after a rising edge (a first take, the
+  // way YLoop's Once holds the delay at its maximum while recording), the
+  // loop start moves to where that edge was written. A shorter delay keeps
+  // the start and wraps the position, so the loop then plays the take from
+  // its beginning.
+  //
+  // That memory is a table of fixed-size pages drawn from a pool. Each rising
+  // edge on Record starts a layer, which stays open until the next rising
+  // edge, undo or redo. The first write that changes a page while a layer is
+  // open moves the page to a fresh copy and keeps the old one with the layer,
+  // so undo also removes the input's fade out after Record falls and any
+  // feedback decay since the layer began. Undo and redo swap those page table
+  // entries back and forth at the next frame boundary, nothing is copied.
+  //
+  // Without an undo pool nothing needs to stay in place, and the pool is a
+  // plain delay line instead: one write head runs through all of it and each
+  // channel reads at the head minus its delay. Other units can read that
+  // contiguous history as a stereo SharedBuffer. When the delay shrinks
+  // within two frames of a falling edge on Record (Once's new Time reaches
+  // the delay through a tie, a frame late), the head steps back to where the
+  // take ended, so the loop plays the take from its beginning there as well.
+  class LayeredDelay : public od::Object
+  {
+  public:
+    LayeredDelay();
+    virtual ~LayeredDelay();
+
+    // UI thread, undoSecs sizes the pool of pages kept for undo
+    bool allocate(float maxSecs, float undoSecs);
+    void deallocate();
+    float getMaxDelay();
+    void undo();
+    void redo();
+    int getUndoDepth();
+    int getRedoDepth();
+    // null when pages can move, i.e. when undo is enabled
+    common::SharedBuffer *getSharedBuffer();
+
+    // stereo frames per page
+    static const int mPageShift = 12;
+    static const int mPageSize = 1 << mPageShift;
+    static const int mPageMask = mPageSize - 1;
+    static const int mMaxLayers = 8;
+
+#ifndef SWIGLUA
+    virtual void process();
+    od::Inlet mLeftInput{"Left In"};
+    od::Inlet mRightInput{"Right In"};
+    od::Inlet mFeedback{"Feedback"};
+    od::Inlet mRecord{"Record"};
+    od::Outlet mLeftOutput{"Left Out"};
+    od::Outlet mRightOutput{"Right Out"};
+    od::Parameter mLeftDelay{"Left Delay"};
+    od::Parameter mRightDelay{"Right Delay"};
+#endif
+
+  private:
+    struct Entry
+    {
+      int page;
+      int copy;
+    };
+
+    struct Layer
+    {
+      // entries live at mEntries[layer index * mPageCount]
+      int count = 0;
+      bool complete = true;
+    };
+
+    // One channel of a loop, which holds [origin, origin + length) of the
+    // page table and wraps at mCapacity.
+    struct Loop
+    {
+      int origin = 0;
+      int offset = 0;
+      int length = 1;
+      // where the last rising edge on Record was written
+      int edge = 0;
+    };
+
+    inline float *pageData(int copy);
+    inline Entry *entries(int layer);
+    inline int position(const Loop &loop);
+    void resize(Loop &loop, int length);
+    void anchor(Loop &loop, int elapsed);
+    void processShared(float *leftIn, float *rightIn, float *feedback, float *record,
+                       float *leftOut, float *rightOut, int leftLength, int rightLength);
+    void beginLayer();
+    void copyOnWrite(int page);
+    void freeLayer(int layer);
+    void swapLayer(int layer);
+    void applyRequests();
+
+    common::SharedBuffer *mPool = 0;
+    bool mShared = false;
+    std::vector<int> mFreeCopies;
+    std::vector<int> mTable;
+    std::vector<uint8_t> mTouched;
+    std::vector<Entry> mEntries;
+    Layer mLayers[mMaxLayers];
+    // oldest layer, undoable layers above it, redoable layers above those
+    int mOldest = 0;
+    int mUndoDepth = 0;
+    int mRedoDepth = 0;
+    bool mRecording = false;
+    // Record level of the previous sample
+    bool mGate = false;
+
+    int mPageCount = 0;
+    int mCapacity = 0;
+    Loop mLeft;
+    Loop mRight;
+    // samples since the rising edge of a take that is still held and has not
+    // moved the loops yet, or -1
+    int mTakeAge = -1;
+    // write head of the shared delay line
+    int mHead = 0;
+    // samples since a falling edge that has not moved the head yet, or -1
+    int mFallAge = -1;
+    float mMaxDelayInSeconds = 0.0f;
+
+    // positive for pending undos, negative for pending redos
+    std::atomic<int> mRequests{0};
+    std::atomic<int> mPublishedUndoDepth{0};
+    std::atomic<int> mPublishedRedoDepth{0};
+    std::atomic<bool> mEnabled{false};
+  };
+} /* namespace yloop */
@@ -1,4 +1,6 @@
 #include <Once.h>
+#include <AllocationAudit.h>
+#include <Trace.h>
 #include <od/config.h>
 #include <hal/ops.h>
 
@@ -21,16 +23,18 @@ namespace yloop
 
   void Once::process()
   {
+    AUDIT_PROCESS();
     float *gate = mGate.buffer();
     float *reset = mReset.buffer();
     float *time = mTimeOut.buffer();
     float *once = mHighAfterOnceOut.buffer();
     float max = mTimeMax.target();
+    int n = FRAMELENGTH;
 
-    if (reset[globalConfig.frameLength - 1] > 0.2f) {
+    if (reset[n - 1] > 0.2f) {
       mResettable = true;
     }
-    if (mResettable && reset[globalConfig.frameLength - 1] < 0.1f) {
+    if (mResettable && reset[n - 1] < 0.1f) {
       mResettable = false;
       mOnce = 0;
     }
@@ -38,7 +42,7 @@ namespace yloop
       mTime = max;
     }
     
-    for (int i = 0; i < globalConfig.frameLength; i++) {
+    for (int i = 0; i < n; i++) {
       if (mOnce == 0) {
         if (gate[i] > 0.0f) {
           mTime = max;
@@ -47,6 +51,7 @@ namespace yloop
           mTime = MIN(mHighCount * globalConfig.samplePeriod, max);
           mHighCount = 0;
           mOnce = 1;
+          TRACE(common::TRACE_ONCE_CAPTURE, 0, mTime, 0.0f);
         }
       }
 
@@ -1,4 +1,5 @@
 #include <Stopwatch.h>
+#include <AllocationAudit.h>
 #include <od/config.h>
 #include <hal/ops.h>
 
@@ -18,10 +19,12 @@ namespace yloop
 
   void Stopwatch::process()
   {
+    AUDIT_PROCESS();
     float *in = mInput.buffer();
     float *out = mOutput.buffer();
     float max = mMax.target();
-    for (int i = 0; i < globalConfig.frameLength; i++) {
+    int n = FRAMELENGTH;
+    for (int i = 0; i < n; i++) {
       if (in[i] > 0.0f) {
         mHighCount++;
         out[i] = MIN(mHighCount * globalConfig.samplePeriod, max);
@@ -36,7 +39,7 @@ namespace yloop
     if (mHighCount > 0) {
       mValue.hardSet(max);
     } else {
-      mValue.hardSet(out[globalConfig.frameLength - 1]);      
+      mValue.hardSet(out[n - 1]);
     }
   }
 } /* namespace yloop */
\ No newline at end of file
@@ -0,0 +1,334 @@
+#include <StreamingDelay.h>
+#include <AllocationAudit.h>
+#include <od/config.h>
+#include <hal/ops.h>
+#include <string.h>
+
+namespace yloop
+{
+  static const int pageBytes = StreamingDelay::mPageSize * 2 * sizeof(float);
+
+  StreamingDelay::StreamingDelay()
+  {
+    addInput(mLeftInput);
+    addInput(mRightInput);
+    addInput(mFeedback);
+    addOutput(mLeftOutput);
+    addOutput(mRightOutput);
+    addParameter(mLeftDelay);
+    addParameter(mRightDelay);
+  }
+
+  StreamingDelay::~StreamingDelay()
+  {
+    deallocate();
+  }
+
+  bool StreamingDelay::open(const char *path, float maxSecs)
+  {
+    deallocate();
+
+    // two pages of headroom so the read heads never reach the pages the
+    // write head is about to reuse
+    mPageCount = (int)(MAX(0.0f, maxSecs) * globalConfig.sampleRate) / mPageSize + 3;
+    mCapacity = mPageCount * mPageSize;
+
+    // The file grows as the write head flushes its pages. A page past the
+    // end of the file has never been written and reads back as silence.
+    mFile = fopen(path, "w+b");
+    if (mFile == 0)
+    {
+      return false;
+    }
+    mPath = path;
+
+    for (Slot &slot : mSlots)
+    {
+      slot.data = new float[2 * mPageSize]();
+      slot.page = -1;
+      slot.state = SlotFree;
+    }
+    mRequests.resize(2 * mSlotCount);
+    mLeftHead = Head();
+    mRightHead = Head();
+    mWriteSlot = 0;
+    mWritePage = -1;
+    mWriteIndex = 0;
+    mUnderruns = 0;
+    mMaxDelayInSeconds = (mCapacity - 2 * mPageSize) * globalConfig.samplePeriod;
+    mEnabled = true;
+    return true;
+  }
+
+  void StreamingDelay::deallocate()
+  {
+    mEnabled = false;
+    if (mFile)
+    {
+      fclose(mFile);
+      mFile = 0;
+      // the file is scratch space, not a recording
+      remove(mPath.c_str());
+    }
+    for (Slot &slot : mSlots)
+    {
+      delete[] slot.data;
+      slot.data = 0;
+      slot.state = SlotFree;
+    }
+    mCapacity = 0;
+    mMaxDelayInSeconds = 0.0f;
+  }
+
+  float StreamingDelay::getMaxDelay()
+  {
+    return mMaxDelayInSeconds;
+  }
+
+  int StreamingDelay::getUnderruns()
+  {
+    return mUnderruns;
+  }
+
+  inline int StreamingDelay::nextPage(int page)
+  {
+    return page + 1 == mPageCount ? 0 : page + 1;
+  }
+
+  StreamingDelay::Slot *StreamingDelay::find(int page)
+  {
+    for (Slot &slot : mSlots)
+    {
+      int state = slot.state.load(std::memory_order_acquire);
+      if (slot.page == page && state != SlotFree && state != SlotDiscarded)
+      {
+        return &slot;
+      }
+    }
+    return 0;
+  }
+
+  StreamingDelay::Slot *StreamingDelay::claim()
+  {
+    Slot *ready = 0;
+    for (Slot &slot : mSlots)
+    {
+      int state = slot.state.load(std::memory_order_acquire);
+      if (state == SlotFree)
+      {
+        return &slot;
+      }
+      if (state == SlotReady && ready == 0 &&
+          slot.page != mWritePage &&
+          slot.page != mLeftHead.page && slot.page != nextPage(mLeftHead.page) &&
+          slot.page != mRightHead.page && slot.page != nextPage(mRightHead.page))
+      {
+        ready = &slot;
+      }
+    }
+    return ready;
+  }
+
+  void StreamingDelay::request(int page)
+  {
+    Slot *slot = claim();
+    if (slot == 0)
+    {
+      return;
+    }
+    slot->page = page;
+    slot->state.store(SlotLoading, std::memory_order_release);
+    if (!mRequests.push(slot - mSlots))
+    {
+      slot->state.store(SlotFree, std::memory_order_release);
+    }
+  }
+
+  StreamingDelay::Slot *StreamingDelay::lookup(int page)
+  {
+    Slot *slot = find(page);
+    if (slot == 0)
+    {
+      mUnderruns++;
+      request(page);
+      return 0;
+    }
+    if (slot->state.load(std::memory_order_acquire) == SlotLoading)
+    {
+      return 0;
+    }
+
+    // prefetch the page this head moves into next, unless the write head
+    // is there (or just ahead of it)
+    int next = nextPage(page);
+    if (page != mWritePage && next != mWritePage && find(next) == 0)
+    {
+      request(next);
+    }
+    return slot;
+  }
+
+  void StreamingDelay::enterWritePage(int page)
+  {
+    if (mWriteSlot)
+    {
+      mWriteSlot->state.store(SlotFlushing, std::memory_order_release);
+      mRequests.push(mWriteSlot - mSlots);
+    }
+
+    mWritePage = page;
+    Slot *slot = find(page);
+    if (slot)
+    {
+      int expected = SlotLoading;
+      if (slot->state.compare_exchange_strong(expected, SlotDiscarded))
+      {
+        // a stale load, service() frees the slot when it finishes
+        slot = 0;
+      }
+      else if (expected != SlotReady)
+      {
+        slot = 0;
+      }
+    }
+    if (slot == 0)
+    {
+      // every sample in the page is about to be overwritten, no need to load
+      slot = claim();
+    }
+    if (slot)
+    {
+      slot->page = page;
+      slot->state.store(SlotWriting, std::memory_order_release);
+    }
+    else
+    {
+      mUnderruns++;
+    }
+    mWriteSlot = slot;
+  }
+
+  inline float StreamingDelay::read(Head &head, int position, int channel)
+  {
+    int page = position >> mPageShift;
+    if (page != head.page)
+    {
+      head.page = page;
+      head.slot = lookup(page);
+    }
+    if (head.slot == 0)
+    {
+      return 0.0f;
+    }
+    return head.slot->data[2 * (position & mPageMask) + channel];
+  }
+
+  void StreamingDelay::process()
+  {
+    AUDIT_PROCESS();
+    float *leftIn = mLeftInput.buffer();
+    float *rightIn = mRightInput.buffer();
+    float *feedback = mFeedback.buffer();
+    float *leftOut = mLeftOutput.buffer();
+    float *rightOut = mRightOutput.buffer();
+
+    if (!mEnabled)
+    {
+      memset(leftOut, 0, sizeof(float) * FRAMELENGTH);
+      memset(rightOut, 0, sizeof(float) * FRAMELENGTH);
+      return;
+    }
+
+    int maxDelay = mCapacity - 2 * mPageSize;
+    int leftDelay = CLAMP(1, maxDelay, (int)(mLeftDelay.value() * globalConfig.sampleRate + 0.5f));
+    int rightDelay = CLAMP(1, maxDelay, (int)(mRightDelay.value() * globalConfig.sampleRate + 0.5f));
+
+    // pick up pages that finished loading since the last frame
+    if (mLeftHead.slot == 0 && mLeftHead.page >= 0)
+    {
+      mLeftHead.slot = lookup(mLeftHead.page);
+    }
+    if (mRightHead.slot == 0 && mRightHead.page >= 0)
+    {
+      mRightHead.slot = lookup(mRightHead.page);
+    }
+
+    for (int i = 0; i < FRAMELENGTH; i++)
+    {
+      int page = mWriteIndex >> mPageShift;
+      if (page != mWritePage)
+      {
+        enterWritePage(page);
+      }
+
+      int left = mWriteIndex - leftDelay;
+      if (left < 0)
+      {
+        left += mCapacity;
+      }
+      int right = mWriteIndex - rightDelay;
+      if (right < 0)
+      {
+        right += mCapacity;
+      }
+
+      float l = read(mLeftHead, left, 0);
+      float r = read(mRightHead, right, 1);
+      leftOut[i] = l;
+      rightOut[i] = r;
+
+      if (mWriteSlot)
+      {
+        float *frame = mWriteSlot->data + 2 * (mWriteIndex & mPageMask);
+        frame[0] = leftIn[i] + feedback[i] * l;
+        frame[1] = rightIn[i] + feedback[i] * r;
+      }
+
+      mWriteIndex++;
+      if (mWriteIndex == mCapacity)
+      {
+        mWriteIndex = 0;
+      }
+    }
+  }
+
+  void StreamingDelay::service()
+  {
+    if (mFile == 0)
+    {
+      return;
+    }
+
+    int index;
+    while (mRequests.pop(index))
+    {
+      Slot &slot = mSlots[index];
+      long offset = (long)slot.page * pageBytes;
+      int state = slot.state.load(std::memory_order_acquire);
+      if (state == SlotFlushing)
+      {
+        if (fseek(mFile, offset, SEEK_SET) != 0 ||
+            fwrite(slot.data, 1, pageBytes, mFile) != (size_t)pageBytes)
+        {
+          mUnderruns++;
+        }
+        slot.state.store(SlotReady, std::memory_order_release);
+      }
+      else if (state == SlotLoading || state == SlotDiscarded)
+      {
+        if (fseek(mFile, offset, SEEK_SET) != 0 ||
+            fread(slot.data, 1, pageBytes, mFile) != (size_t)pageBytes)
+        {
+          memset(slot.data, 0, pageBytes);
+        }
+        int expected = SlotLoading;
+        if (!slot.state.compare_exchange_strong(expected, SlotReady))
+        {
+          // the write head took this page over while it was loading
+          slot.state.store(SlotFree, std::memory_order_release);
+        }
+      }
+    }
+  }
+
+} /* namespace yloop */
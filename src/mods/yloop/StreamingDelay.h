@@ -0,0 +1,101 @@
+#pragma once
+
+#include <od/objects/Object.h>
+#include <SpscQueue.h>
+#include <atomic>
+#include <stdio.h>
+#include <string>
+
+namespace yloop
+{
+  // Stereo feedback delay (same ports as libcore.Delay) whose memory is a
+  // file. Only a few pages around the write head and the two read heads are
+  // held in RAM. service(), which the unit calls from a UI timer, loads the
+  // page after each read head ahead of time and writes back each page the
+  // write head leaves. The audio thread only exchanges page slots with it
+  // through a lock-free queue: a page that is not in RAM yet reads as
+  // silence instead of blocking.
+  class StreamingDelay : public od::Object
+  {
+  public:
+    StreamingDelay();
+    virtual ~StreamingDelay();
+
+    // UI thread
+    bool open(const char *path, float maxSecs);
+    void deallocate();
+    float getMaxDelay();
+    int getUnderruns();
+    // does the file I/O the audio thread asked for, call it well within the
+    // time a page lasts (170 ms at 48 kHz)
+    void service();
+
+    // stereo frames per page
+    static const int mPageShift = 13;
+    static const int mPageSize = 1 << mPageShift;
+    static const int mPageMask = mPageSize - 1;
+    static const int mSlotCount = 8;
+
+#ifndef SWIGLUA
+    virtual void process();
+    od::Inlet mLeftInput{"Left In"};
+    od::Inlet mRightInput{"Right In"};
+    od::Inlet mFeedback{"Feedback"};
+    od::Outlet mLeftOutput{"Left Out"};
+    od::Outlet mRightOutput{"Right Out"};
+    od::Parameter mLeftDelay{"Left Delay"};
+    od::Parameter mRightDelay{"Right Delay"};
+#endif
+
+  private:
+    // Only the audio thread moves a slot out of Free, Ready or Writing, only
+    // service() moves it out of Loading or Flushing.
+    enum SlotState
+    {
+      SlotFree,
+      SlotLoading,
+      SlotDiscarded,
+      SlotReady,
+      SlotWriting,
+      SlotFlushing
+    };
+
+    struct Slot
+    {
+      float *data = 0;
+      int page = -1;
+      std::atomic<int> state{SlotFree};
+    };
+
+    struct Head
+    {
+      int page = -1;
+      Slot *slot = 0;
+    };
+
+    // audio thread
+    Slot *find(int page);
+    Slot *claim();
+    void request(int page);
+    Slot *lookup(int page);
+    void enterWritePage(int page);
+    inline int nextPage(int page);
+    inline float read(Head &head, int position, int channel);
+
+    Slot mSlots[mSlotCount];
+    common::SpscQueue<int> mRequests;
+    Head mLeftHead;
+    Head mRightHead;
+    Slot *mWriteSlot = 0;
+    int mWritePage = -1;
+    int mWriteIndex = 0;
+    int mPageCount = 0;
+    int mCapacity = 0;
+    float mMaxDelayInSeconds = 0.0f;
+
+    std::string mPath;
+    FILE *mFile = 0;
+    std::atomic<int> mUnderruns{0};
+    std::atomic<bool> mEnabled{false};
+  };
+} /* namespace yloop */
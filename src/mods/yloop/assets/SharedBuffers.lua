@@ -0,0 +1,87 @@
+-- Copyright (c) 2021, Jeroen Baekelandt
+-- All rights reserved.
+-- Redistribution and use in source and binary forms, with or without modification,
+-- are permitted provided that the following conditions are met:
+-- * Redistributions of source code must retain the above copyright notice, this
+--   list of conditions and the following disclaimer.
+-- * Redistributions in binary form must reproduce the above copyright notice, this
+--   list of conditions and the following disclaimer in the documentation and/or
+--   other materials provided with the distribution.
+-- * Neither the name of the {organization} nor the names of its
+--   contributors may be used to endorse or promote products derived from
+--   this software without specific prior written permission.
+-- THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+-- ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+-- WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+-- DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+-- ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+-- (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+-- LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+-- ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+-- (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+-- SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+-- Buffers published by units under a name, for units in any package to read
+-- without recording the same audio twice. The C++ objects are reference
+-- counted: a reader attaches the buffer and keeps it alive after the
+-- publisher withdraws it.
+local SharedBuffers = {}
+
+local buffers = {}
+-- readers waiting for a name, keyed by reader
+local watchers = {}
+
+function SharedBuffers.publish(name, buffer)
+  buffers[name] = buffer
+  for _, watcher in pairs(watchers) do
+    if watcher.name == name then
+      watcher.callback(buffer)
+    end
+  end
+end
+
+function SharedBuffers.withdraw(name, buffer)
+  if buffers[name] == buffer then
+    buffers[name] = nil
+  end
+end
+
+function SharedBuffers.find(name)
+  return buffers[name]
+end
+
+-- Calls callback(buffer) each time a buffer is published under name, e.g.
+-- for a reader loaded before the unit it reads from. A reader watches one
+-- name at a time.
+function SharedBuffers.watch(reader, name, callback)
+  watchers[reader] = {
+    name = name,
+    callback = callback
+  }
+end
+
+function SharedBuffers.unwatch(reader)
+  watchers[reader] = nil
+end
+
+-- base, or base followed by the first number that makes it unused
+function SharedBuffers.uniqueName(base)
+  local name = base
+  local i = 1
+  while buffers[name] do
+    i = i + 1
+    name = string.format("%s %d", base, i)
+  end
+  return name
+end
+
+function SharedBuffers.names()
+  local names = {}
+  for name in pairs(buffers) do
+    names[#names + 1] = name
+  end
+  table.sort(names)
+  return names
+end
+
+return SharedBuffers
@@ -28,21 +28,38 @@ local libcore = require "core.libcore"
 local Gate = require "Unit.ViewControl.Gate"
 local GainBias = require "Unit.ViewControl.GainBias"
 local libyloop = require "yloop.libyloop"
+local MenuHeader = require "Unit.MenuControl.Header"
+local Task = require "Unit.MenuControl.Task"
 
 local YLoop = Class {}
 YLoop:include(Unit)
 
 function YLoop:init(args)
-  args.title = "Y Looper"
-  args.mnemonic = "YLoop"
-  args.version = 1
+  -- variants name themselves and size their memory before calling this
+  if not args.mnemonic then
+    args.title = "Y Looper"
+    args.mnemonic = "YLoop"
+  end
+  args.version = args.version or 1
 
-  self.maxDelay = 60.0
+  self.maxDelay = self.maxDelay or 60.0
+  -- seconds of overdubbed material kept for undo
+  self.undoTime = self.undoTime or 20.0
 
   Unit.init(self, args)
 end
 
+function YLoop:createLoopDelay()
+  local delay = self:addObject("delay", libyloop.LayeredDelay())
+  delay:allocate(self.maxDelay, self.undoTime)
+  self.undoable = self.undoTime > 0
+  return delay
+end
+
 function YLoop:onLoadGraph(channelCount)
+  -- the loop memory decides self.maxDelay, so create it first
+  local delay = self:createLoopDelay()
+
   -- controls
   local recordGate = self:addObject("recordGate", app.Comparator())
   recordGate:setGateMode()
@@ -55,8 +72,9 @@ function YLoop:onLoadGraph(channelCount)
   self:addMonoBranch("rlFraction", rlFraction, "In", rlFraction, "Out")
 
   local feedback = self:addObject("feedback", app.GainBias())
-  local feedbackRange = self:addObject("feedbackRange", app.MinMax())
-  connect(feedback, "Out", feedbackRange, "In")
+  local rangeMeter = self:addObject("rangeMeter", libyloop.RangeMeter())
+  self:addObject("feedbackRange", rangeMeter:watch("feedback"))
+  connect(feedback, "Out", rangeMeter, "feedback")
   self:addMonoBranch("feedback", feedback, "In", feedback, "Out")
 
   local suppression = self:addObject("suppression", app.ParameterAdapter())
@@ -134,10 +152,8 @@ function YLoop:onLoadGraph(channelCount)
   connect(suppOutOnFirstRecord, "Out", suppOut, "In")
   
   -- hooking it all up to the delay lines
-  local delay = self:addObject("delay", libcore.Delay(2))
   local outL = self:addObject("outL", app.Multiply())
   local outR = self:addObject("outR", app.Multiply())
-  delay:allocateTimeUpTo(self.maxDelay)
   connect(inputL, "Out", delay, "Left In")
   connect(inputR, "Out", delay, "Right In")
   connect(delay, "Left Out", outL, "Left")
@@ -153,6 +169,11 @@ function YLoop:onLoadGraph(channelCount)
     once, "Time", sizeFraction, "Out", rlFraction, "Out", once, "High After Once")
 
   connect(feedbackSupp, "Out", delay, "Feedback")
+
+  if self.undoable then
+    -- every record gate starts a new undoable layer
+    connect(recordGate, "Out", delay, "Record")
+  end
 end
 
 function YLoop:onLoadViews(objects, branches)
@@ -212,6 +233,43 @@ function YLoop:onLoadViews(objects, branches)
   return controls, views
 end
 
+function YLoop:onShowMenu(objects, branches)
+  local controls = {}
+  local menu = {}
+
+  if not self.undoable then
+    return controls, menu
+  end
+
+  -- pages stay in place for undo, so the loop is not a delay line here
+  controls.sizeHeader = MenuHeader {
+    description = "Size and R/L play the loop from its start."
+  }
+
+  local delay = objects.delay
+  controls.undoHeader = MenuHeader {
+    description = string.format("Layers: %d to undo, %d to redo.",
+      delay:getUndoDepth(), delay:getRedoDepth())
+  }
+
+  controls.undo = Task {
+    description = "Undo",
+    task = function()
+      delay:undo()
+    end
+  }
+
+  controls.redo = Task {
+    description = "Redo",
+    task = function()
+      delay:redo()
+    end
+  }
+
+  menu = {"sizeHeader", "undoHeader", "undo", "redo"}
+  return controls, menu
+end
+
 function YLoop:onRemove()
   self.objects.delay:deallocate()
   Unit.onRemove(self)
@@ -0,0 +1,84 @@
+-- Copyright (c) 2021, Jeroen Baekelandt
+-- All rights reserved.
+-- Redistribution and use in source and binary forms, with or without modification,
+-- are permitted provided that the following conditions are met:
+-- * Redistributions of source code must retain the above copyright notice, this
+--   list of conditions and the following disclaimer.
+-- * Redistributions in binary form must reproduce the above copyright notice, this
+--   list of conditions and the following disclaimer in the documentation and/or
+--   other materials provided with the distribution.
+-- * Neither the name of the {organization} nor the names of its
+--   contributors may be used to endorse or promote products derived from
+--   this software without specific prior written permission.
+-- THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+-- ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+-- WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+-- DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+-- ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+-- (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+-- LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+-- ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+-- (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+-- SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+local Class = require "Base.Class"
+local YLoop = require "yloop.YLoop"
+local SharedBuffers = require "yloop.SharedBuffers"
+
+-- YLoop without undo, so the loop memory never moves and other units (e.g.
+-- the Manual Grain Delay) can read it in place under a published name.
+local YLoopShared = Class {}
+YLoopShared:include(YLoop)
+
+function YLoopShared:init(args)
+  args.title = "Y Looper Shared"
+  args.mnemonic = "YLSh"
+  args.version = 1
+
+  self.maxDelay = 60.0
+  self.undoTime = 0
+
+  YLoop.init(self, args)
+end
+
+function YLoopShared:createLoopDelay()
+  local delay = YLoop.createLoopDelay(self)
+  local buffer = delay:getSharedBuffer()
+  if buffer then
+    self.sharedBuffer = buffer
+    self:publish(SharedBuffers.uniqueName(self.title or "Loop"))
+  end
+  return delay
+end
+
+-- Readers save the name they read from, so it is saved with this unit too.
+function YLoopShared:publish(name)
+  if self.sharedName then
+    SharedBuffers.withdraw(self.sharedName, self.sharedBuffer)
+  end
+  self.sharedName = name
+  SharedBuffers.publish(name, self.sharedBuffer)
+end
+
+function YLoopShared:serialize()
+  local t = YLoop.serialize(self)
+  t.sharedName = self.sharedName
+  return t
+end
+
+function YLoopShared:deserialize(t)
+  YLoop.deserialize(self, t)
+  -- the saved name, unless another unit holds it (e.g. this is a copy)
+  local name = t.sharedName
+  if self.sharedBuffer and name and name ~= self.sharedName and SharedBuffers.find(name) == nil then
+    self:publish(name)
+  end
+end
+
+function YLoopShared:onRemove()
+  if self.sharedName then
+    SharedBuffers.withdraw(self.sharedName, self.sharedBuffer)
+  end
+  YLoop.onRemove(self)
+end
+
+return YLoopShared
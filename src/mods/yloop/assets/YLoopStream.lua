@@ -0,0 +1,74 @@
+-- Copyright (c) 2021, Jeroen Baekelandt
+-- All rights reserved.
+-- Redistribution and use in source and binary forms, with or without modification,
+-- are permitted provided that the following conditions are met:
+-- * Redistributions of source code must retain the above copyright notice, this
+--   list of conditions and the following disclaimer.
+-- * Redistributions in binary form must reproduce the above copyright notice, this
+--   list of conditions and the following disclaimer in the documentation and/or
+--   other materials provided with the distribution.
+-- * Neither the name of the {organization} nor the names of its
+--   contributors may be used to endorse or promote products derived from
+--   this software without specific prior written permission.
+-- THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+-- ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+-- WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+-- DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+-- ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+-- (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+-- LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+-- ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+-- (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+-- SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+local Class = require "Base.Class"
+local YLoop = require "yloop.YLoop"
+local libyloop = require "yloop.libyloop"
+local FS = require "Card.FileSystem"
+local Timer = require "Timer"
+
+-- YLoop with its loop memory paged to a scratch file on the card, for loops
+-- far longer than fit in RAM.
+local YLoopStream = Class {}
+YLoopStream:include(YLoop)
+
+local streams = 0
+
+local function streamPath()
+  streams = streams + 1
+  return string.format("%s/yloop-%d-%d.stream", FS.getRoot("rear"), os.time(), streams)
+end
+
+function YLoopStream:init(args)
+  args.title = "Y Looper Stream"
+  args.mnemonic = "YLS"
+  args.version = 1
+
+  self.maxDelay = 600.0
+
+  YLoop.init(self, args)
+end
+
+function YLoopStream:createLoopDelay()
+  local delay = libyloop.StreamingDelay()
+  if delay:open(streamPath(), self.maxDelay) then
+    -- the file I/O runs here on the UI thread, a page lasts about 170 ms
+    self.streamTimer = Timer.every(0.05, function()
+      delay:service()
+    end)
+    return self:addObject("delay", delay)
+  end
+
+  -- no card to stream to, fall back to a RAM loop
+  self.maxDelay = 60.0
+  return YLoop.createLoopDelay(self)
+end
+
+function YLoopStream:onRemove()
+  if self.streamTimer then
+    Timer.cancel(self.streamTimer)
+    self.streamTimer = nil
+  end
+  YLoop.onRemove(self)
+end
+
+return YLoopStream
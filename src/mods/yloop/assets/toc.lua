@@ -32,6 +32,16 @@ return {
       moduleName = "YLoop",
       keywords = "delay",
       channelCount = 2
+    }, {
+      title = "YLoop Stream",
+      moduleName = "YLoopStream",
+      keywords = "delay",
+      channelCount = 2
+    }, {
+      title = "YLoop Shared",
+      moduleName = "YLoopShared",
+      keywords = "delay",
+      channelCount = 2
     }
   }
 }
@@ -5,6 +5,7 @@ local Fader = require "Unit.ViewControl.Fader"
 local Encoder = require "Encoder"
 local GainBias = require "Unit.ViewControl.GainBias"
 local Pitch = require "Unit.ViewControl.Pitch"
+local libyutil = require "yutil.libyutil"
 
 local EQSweeps = Class {}
 EQSweeps:include(Unit)
@@ -17,29 +18,32 @@ function EQSweeps:init(args)
 end
 
 function EQSweeps:onLoadGraph(channelCount)
+  -- one meter shows the range of every control
+  local rangeMeter = self:addObject("rangeMeter", libyutil.RangeMeter())
+
   local resonance = self:addObject("resonance", app.GainBias())
-  local resonanceRange = self:addObject("resonanceRange", app.MinMax())
-  connect(resonance, "Out", resonanceRange, "In")
+  self:addObject("resonanceRange", rangeMeter:watch("resonance"))
+  connect(resonance, "Out", rangeMeter, "resonance")
   self:addMonoBranch("resonance", resonance, "In", resonance, "Out")
 
   local width = self:addObject("width", app.GainBias())
-  local widthRange = self:addObject("widthRange", app.MinMax())
-  connect(width, "Out", widthRange, "In")
+  self:addObject("widthRange", rangeMeter:watch("width"))
+  connect(width, "Out", rangeMeter, "width")
   self:addMonoBranch("width", width, "In", width, "Out")
 
   local speed = self:addObject("speed", app.GainBias())
-  local speedRange = self:addObject("speedRange", app.MinMax())
-  connect(speed, "Out", speedRange, "In")
+  self:addObject("speedRange", rangeMeter:watch("speed"))
+  connect(speed, "Out", rangeMeter, "speed")
   self:addMonoBranch("speed", speed, "In", speed, "Out")
 
   local amp = self:addObject("amp", app.GainBias())
-  local ampRange = self:addObject("ampRange", app.MinMax())
-  connect(amp, "Out", ampRange, "In")
+  self:addObject("ampRange", rangeMeter:watch("amp"))
+  connect(amp, "Out", rangeMeter, "amp")
   self:addMonoBranch("amp", amp, "In", amp, "Out")
 
   local center = self:addObject("center", app.GainBias())
-  local centerRange = self:addObject("centerRange", app.MinMax())
-  connect(center, "Out", centerRange, "In")
+  self:addObject("centerRange", rangeMeter:watch("center"))
+  connect(center, "Out", rangeMeter, "center")
   self:addMonoBranch("center", center, "In", center, "Out")
 
   local zero = self:addObject("zero", app.Constant())
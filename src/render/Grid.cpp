@@ -0,0 +1,128 @@
+#include <Grid.h>
+#include <fstream>
+#include <sstream>
+
+namespace render
+{
+
+  bool Grid::parse(const std::string &path, std::string &error)
+  {
+    std::ifstream file(path.c_str());
+    if (!file)
+    {
+      error = "cannot open " + path;
+      return false;
+    }
+
+    std::string line;
+    int number = 0;
+    while (std::getline(file, line))
+    {
+      number++;
+      size_t comment = line.find('#');
+      if (comment != std::string::npos)
+      {
+        line.erase(comment);
+      }
+
+      std::istringstream words(line);
+      std::string directive;
+      if (!(words >> directive))
+      {
+        continue;
+      }
+
+      std::ostringstream where;
+      where << path << ":" << number << ": ";
+
+      if (directive == "object")
+      {
+        words >> object;
+        continue;
+      }
+      if (directive == "tail")
+      {
+        words >> tail;
+        continue;
+      }
+
+      Axis axis;
+      if (directive == "param")
+      {
+        axis.kind = AXIS_PARAMETER;
+      }
+      else if (directive == "option")
+      {
+        axis.kind = AXIS_OPTION;
+      }
+      else if (directive == "inlet")
+      {
+        axis.kind = AXIS_INLET;
+      }
+      else if (directive == "pulse")
+      {
+        axis.kind = AXIS_PULSE;
+      }
+      else
+      {
+        error = where.str() + "unknown directive " + directive;
+        return false;
+      }
+
+      // names may contain spaces when quoted, e.g. "Left Delay"
+      words >> std::ws;
+      if (words.peek() == '"')
+      {
+        words.get();
+        std::getline(words, axis.name, '"');
+      }
+      else
+      {
+        words >> axis.name;
+      }
+
+      float value;
+      while (words >> value)
+      {
+        axis.values.push_back(value);
+      }
+      if (axis.name.empty() || axis.values.empty())
+      {
+        error = where.str() + "expected a name and at least one value";
+        return false;
+      }
+      axes.push_back(axis);
+    }
+
+    if (object.empty())
+    {
+      error = path + ": no object given";
+      return false;
+    }
+    return true;
+  }
+
+  int Grid::getCombinationCount() const
+  {
+    int count = 1;
+    for (const Axis &axis : axes)
+    {
+      count *= axis.values.size();
+    }
+    return count;
+  }
+
+  std::vector<float> Grid::getCombination(int index) const
+  {
+    // mixed radix, the last axis changes fastest
+    std::vector<float> values(axes.size());
+    for (int i = axes.size() - 1; i >= 0; i--)
+    {
+      int n = axes[i].values.size();
+      values[i] = axes[i].values[index % n];
+      index /= n;
+    }
+    return values;
+  }
+
+} /* namespace render */
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace render
+{
+
+  // A sweep description, one directive per line ('#' starts a comment):
+  //
+  //   object MonoManualGrainDelay   object to render (see render --list)
+  //   param Duration 0.05 0.1 0.2   parameter values to sweep
+  //   option Snap 1 2               option values to sweep
+  //   inlet Speed 0.5 1 2           constant signals on an inlet
+  //   pulse Trigger 10 40           one-sample pulses at these rates (Hz)
+  //   tail 2                        seconds rendered after the input ends
+  //
+  // Every param, option, inlet and pulse line is an axis and every
+  // combination of their values is rendered for every input file.
+  enum AxisKind
+  {
+    AXIS_PARAMETER,
+    AXIS_OPTION,
+    AXIS_INLET,
+    AXIS_PULSE
+  };
+
+  struct Axis
+  {
+    AxisKind kind;
+    std::string name;
+    std::vector<float> values;
+  };
+
+  struct Grid
+  {
+    std::string object;
+    std::vector<Axis> axes;
+    float tail = 2.0f;
+
+    bool parse(const std::string &path, std::string &error);
+    int getCombinationCount() const;
+    // the value of every axis for one combination
+    std::vector<float> getCombination(int index) const;
+  };
+
+} /* namespace render */
@@ -0,0 +1,110 @@
+#include <Objects.h>
+#include <Diffuser.h>
+#include <FeedbackMatrix.h>
+#include <GrainCloud.h>
+#include <LayeredDelay.h>
+#include <LazyDelay.h>
+#include <LazyStereoDelay.h>
+#include <MonoManualGrainDelay.h>
+#include <PitchShifter.h>
+
+namespace render
+{
+
+  // Sizes match what the units ask for on the ER-301.
+
+  static od::Object *createMonoManualGrainDelay()
+  {
+    return new fdelay::MonoManualGrainDelay(5.0f);
+  }
+
+  static od::Object *createGrainCloud()
+  {
+    return new fdelay::GrainCloud(5.0f);
+  }
+
+  static od::Object *createPitchShifter()
+  {
+    return new fdelay::PitchShifter();
+  }
+
+  static od::Object *createLazyDelay()
+  {
+    return new fdelay::LazyDelay(2.0f);
+  }
+
+  // The sweep can ask for any delay up to the maximum, so reserve all of it
+  // instead of the 1 s the object starts with.
+  static void prepareLazyDelay(od::Object *object)
+  {
+    fdelay::LazyDelay *delay = static_cast<fdelay::LazyDelay *>(object);
+    delay->reserve(delay->getMaxDelay());
+  }
+
+  static void maintainLazyDelay(od::Object *object)
+  {
+    static_cast<fdelay::LazyDelay *>(object)->maintain();
+  }
+
+  static od::Object *createLazyStereoDelay()
+  {
+    return new fdelay::LazyStereoDelay(2.0f);
+  }
+
+  static void prepareLazyStereoDelay(od::Object *object)
+  {
+    fdelay::LazyStereoDelay *delay = static_cast<fdelay::LazyStereoDelay *>(object);
+    delay->reserve(delay->getMaxDelay());
+  }
+
+  static void maintainLazyStereoDelay(od::Object *object)
+  {
+    static_cast<fdelay::LazyStereoDelay *>(object)->maintain();
+  }
+
+  static od::Object *createFeedbackMatrix()
+  {
+    return new fdelay::FeedbackMatrix();
+  }
+
+  static od::Object *createDiffuser()
+  {
+    return new fdelay::Diffuser();
+  }
+
+  static od::Object *createLayeredDelay()
+  {
+    yloop::LayeredDelay *delay = new yloop::LayeredDelay();
+    delay->allocate(10.0f, 5.0f);
+    return delay;
+  }
+
+  const std::vector<ObjectSpec> &getObjectSpecs()
+  {
+    static const std::vector<ObjectSpec> specs = {
+        {"MonoManualGrainDelay", createMonoManualGrainDelay, {"In"}, {"Out"}},
+        {"GrainCloud", createGrainCloud, {"In"}, {"Left Out", "Right Out"}},
+        {"PitchShifter", createPitchShifter, {"In"}, {"Out"}},
+        {"LazyDelay", createLazyDelay, {"In"}, {"Out"}, prepareLazyDelay, maintainLazyDelay},
+        {"LazyStereoDelay", createLazyStereoDelay, {"Left In", "Right In"}, {"Left Out", "Right Out"},
+         prepareLazyStereoDelay, maintainLazyStereoDelay},
+        {"Diffuser", createDiffuser, {"Left In", "Right In"}, {"Left Out", "Right Out"}},
+        {"FeedbackMatrix", createFeedbackMatrix, {"In1", "In2", "In3", "In4"}, {"Out1", "Out2", "Out3", "Out4"}},
+        {"LayeredDelay", createLayeredDelay, {"Left In", "Right In"}, {"Left Out", "Right Out"}},
+    };
+    return specs;
+  }
+
+  const ObjectSpec *findObjectSpec(const std::string &name)
+  {
+    for (const ObjectSpec &spec : getObjectSpecs())
+    {
+      if (name == spec.name)
+      {
+        return &spec;
+      }
+    }
+    return 0;
+  }
+
+} /* namespace render */
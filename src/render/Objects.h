@@ -0,0 +1,29 @@
+#pragma once
+
+#include <od/objects/Object.h>
+#include <string>
+#include <vector>
+
+namespace render
+{
+
+  // An object the harness knows how to build, with the inlets that take the
+  // input file and the outlets that are written to the output file.
+  //
+  // prepare() runs once the sweep values are applied, before the first frame.
+  // maintain() then runs every 100 ms of audio, as the unit's UI timer would
+  // on the ER-301. Both are optional.
+  struct ObjectSpec
+  {
+    const char *name;
+    od::Object *(*create)();
+    std::vector<std::string> inputs;
+    std::vector<std::string> outputs;
+    void (*prepare)(od::Object *object);
+    void (*maintain)(od::Object *object);
+  };
+
+  const std::vector<ObjectSpec> &getObjectSpecs();
+  const ObjectSpec *findObjectSpec(const std::string &name);
+
+} /* namespace render */
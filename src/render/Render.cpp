@@ -0,0 +1,748 @@
+// Offline parameter-sweep renderer.
+//
+//   render [-j threads] [-f frameLength] [-o outdir] [-r refdir [-t tolerance]] grid.txt in.wav...
+//   render --list
+//   render --generate out.wav seconds
+//
+// Every combination in the grid is rendered for every input file and written
+// to outdir as 32-bit float WAV, along with outdir/metrics.csv. When refdir
+// holds a file of the same name the output is compared against it. With a
+// tolerance, a missing reference or a larger difference fails the run.
+//
+// --generate writes a deterministic stereo test signal (decaying tone bursts
+// on the left, noise bursts on the right) to render the examples with.
+//
+// Each render runs in its own process. The object code relies on globals
+// (globalConfig, the audio thread frame pool, the trace ring) that are not
+// safe to share between threads, so the thread pool only schedules renders,
+// it never runs two objects in one address space.
+
+#include <Grid.h>
+#include <Objects.h>
+#include <ThreadPool.h>
+#include <Wav.h>
+#include <od/config.h>
+#include <od/objects/Object.h>
+#include <hal/ops.h>
+#include <fcntl.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <memory>
+#include <mutex>
+#include <sstream>
+
+namespace render
+{
+
+  struct Settings
+  {
+    int threads = 0;
+    int frameLength = 128;
+    std::string outDir = "render-out";
+    std::string refDir;
+    // largest allowed difference to the reference, negative to only report it
+    float tolerance = -1.0f;
+    std::string gridPath;
+    std::vector<std::string> inputs;
+  };
+
+  struct Metrics
+  {
+    bool ok = false;
+    // seconds spent in process() and the slowest single frame
+    double processSeconds = 0.0;
+    double worstFrameSeconds = 0.0;
+    double audioSeconds = 0.0;
+    int sampleRate = 0;
+    float peak = 0.0f;
+    float rms = 0.0f;
+    bool compared = false;
+    float refMaxDiff = 0.0f;
+    float refRmsDiff = 0.0f;
+    // from the child process
+    double cpuSeconds = 0.0;
+    long maxRssKb = 0;
+    std::string file;
+  };
+
+  // Drives the inlets of the object under test with the input file,
+  // constant signals and pulse trains.
+  class Feeder : public od::Object
+  {
+  public:
+    Feeder(const Audio &audio) : mAudio(audio)
+    {
+    }
+
+    od::Outlet *addChannel(int channel)
+    {
+      return add(SOURCE_CHANNEL, channel, 0.0f);
+    }
+
+    od::Outlet *addConstant(float value)
+    {
+      return add(SOURCE_CONSTANT, 0, value);
+    }
+
+    od::Outlet *addPulse(float hz)
+    {
+      return add(SOURCE_PULSE, 0, hz);
+    }
+
+    virtual void process()
+    {
+      int base = mFrame * FRAMELENGTH;
+      for (Source &source : mSources)
+      {
+        float *out = source.outlet->buffer();
+        switch (source.kind)
+        {
+        case SOURCE_CHANNEL:
+          for (int i = 0; i < FRAMELENGTH; i++)
+          {
+            int j = base + i;
+            out[i] = j < mAudio.frames() ? mAudio.at(j, source.channel) : 0.0f;
+          }
+          break;
+        case SOURCE_CONSTANT:
+          for (int i = 0; i < FRAMELENGTH; i++)
+          {
+            out[i] = source.value;
+          }
+          break;
+        case SOURCE_PULSE:
+        {
+          float period = source.value > 0.0f ? globalConfig.sampleRate / source.value : 0.0f;
+          for (int i = 0; i < FRAMELENGTH; i++)
+          {
+            out[i] = 0.0f;
+            if (period > 0.0f)
+            {
+              source.countdown -= 1.0f;
+              if (source.countdown <= 0.0f)
+              {
+                out[i] = 1.0f;
+                source.countdown += period;
+              }
+            }
+          }
+          break;
+        }
+        }
+      }
+      mFrame++;
+    }
+
+  private:
+    enum SourceKind
+    {
+      SOURCE_CHANNEL,
+      SOURCE_CONSTANT,
+      SOURCE_PULSE
+    };
+
+    struct Source
+    {
+      SourceKind kind;
+      int channel;
+      float value;
+      float countdown;
+      std::unique_ptr<od::Outlet> outlet;
+    };
+
+    od::Outlet *add(SourceKind kind, int channel, float value)
+    {
+      std::ostringstream name;
+      name << "Out" << mSources.size() + 1;
+      mSources.emplace_back();
+      Source &source = mSources.back();
+      source.kind = kind;
+      source.channel = channel;
+      source.value = value;
+      source.countdown = 0.0f;
+      source.outlet.reset(new od::Outlet(name.str()));
+      addOutput(*source.outlet);
+      return source.outlet.get();
+    }
+
+    const Audio &mAudio;
+    std::vector<Source> mSources;
+    int mFrame = 0;
+  };
+
+  static std::string sanitize(const std::string &text)
+  {
+    std::string result = text;
+    for (char &c : result)
+    {
+      if (!isalnum((unsigned char)c) && c != '.' && c != '-' && c != '=')
+      {
+        c = '_';
+      }
+    }
+    return result;
+  }
+
+  static std::string stem(const std::string &path)
+  {
+    size_t slash = path.find_last_of('/');
+    std::string name = slash == std::string::npos ? path : path.substr(slash + 1);
+    size_t dot = name.find_last_of('.');
+    return dot == std::string::npos ? name : name.substr(0, dot);
+  }
+
+  static std::string formatValue(float value)
+  {
+    char text[32];
+    snprintf(text, sizeof(text), "%g", value);
+    return text;
+  }
+
+  static std::string getOutputName(const Grid &grid, const std::vector<float> &values,
+                                    const std::string &input)
+  {
+    std::string name = grid.object + "_" + stem(input);
+    for (size_t i = 0; i < grid.axes.size(); i++)
+    {
+      name += "_" + grid.axes[i].name + "=" + formatValue(values[i]);
+    }
+    return sanitize(name) + ".wav";
+  }
+
+  static double threadSeconds()
+  {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+  }
+
+  static void compare(const Audio &out, const Audio &ref, Metrics &metrics)
+  {
+    int frames = MIN(out.frames(), ref.frames());
+    int channels = MIN(out.channels, ref.channels);
+    double sum = 0.0;
+    float worst = 0.0f;
+    for (int i = 0; i < frames; i++)
+    {
+      for (int c = 0; c < channels; c++)
+      {
+        float d = fabsf(out.at(i, c) - ref.at(i, c));
+        worst = MAX(worst, d);
+        sum += (double)d * d;
+      }
+    }
+    int n = MAX(1, frames * channels);
+    metrics.compared = true;
+    metrics.refMaxDiff = worst;
+    metrics.refRmsDiff = sqrt(sum / n);
+  }
+
+  // Runs in the child process.
+  static bool renderJob(const Settings &settings, const Grid &grid, int job,
+                        Metrics &metrics, std::string &error)
+  {
+    const ObjectSpec *spec = findObjectSpec(grid.object);
+    if (spec == 0)
+    {
+      error = "unknown object " + grid.object;
+      return false;
+    }
+
+    int inputCount = settings.inputs.size();
+    const std::string &inputPath = settings.inputs[job % inputCount];
+    std::vector<float> values = grid.getCombination(job / inputCount);
+
+    Audio input;
+    if (!readWav(inputPath, input, error))
+    {
+      return false;
+    }
+
+    globalConfig.sampleRate = input.sampleRate;
+    globalConfig.samplePeriod = 1.0f / input.sampleRate;
+    globalConfig.frameLength = settings.frameLength;
+
+    od::Object *object = spec->create();
+    object->attach();
+    Feeder feeder(input);
+
+    for (size_t i = 0; i < spec->inputs.size(); i++)
+    {
+      od::Inlet *inlet = object->getInput(spec->inputs[i]);
+      if (inlet)
+      {
+        inlet->connect(feeder.addChannel(i % input.channels));
+      }
+    }
+
+    for (size_t i = 0; i < grid.axes.size(); i++)
+    {
+      const Axis &axis = grid.axes[i];
+      bool found = false;
+      switch (axis.kind)
+      {
+      case AXIS_PARAMETER:
+      {
+        od::Parameter *parameter = object->getParameter(axis.name);
+        if ((found = parameter != 0))
+        {
+          parameter->hardSet(values[i]);
+        }
+        break;
+      }
+      case AXIS_OPTION:
+      {
+        od::Option *option = object->getOption(axis.name);
+        if ((found = option != 0))
+        {
+          option->set((int)values[i]);
+        }
+        break;
+      }
+      case AXIS_INLET:
+      case AXIS_PULSE:
+      {
+        od::Inlet *inlet = object->getInput(axis.name);
+        if ((found = inlet != 0))
+        {
+          inlet->connect(axis.kind == AXIS_INLET ? feeder.addConstant(values[i])
+                                                 : feeder.addPulse(values[i]));
+        }
+        break;
+      }
+      }
+      if (!found)
+      {
+        error = grid.object + " has no " + axis.name;
+        object->release();
+        return false;
+      }
+    }
+
+    if (spec->prepare)
+    {
+      spec->prepare(object);
+    }
+
+    std::vector<od::Outlet *> outlets;
+    for (const std::string &name : spec->outputs)
+    {
+      outlets.push_back(object->getOutput(name));
+    }
+
+    int total = input.frames() + (int)(grid.tail * input.sampleRate);
+    int frames = (total + FRAMELENGTH - 1) / FRAMELENGTH;
+
+    Audio output;
+    output.sampleRate = input.sampleRate;
+    output.channels = outlets.size();
+    output.data.resize(frames * FRAMELENGTH * output.channels);
+
+    int maintainFrames = MAX(1, (int)(0.1f * input.sampleRate / FRAMELENGTH));
+    for (int frame = 0; frame < frames; frame++)
+    {
+      if (spec->maintain && frame % maintainFrames == 0)
+      {
+        spec->maintain(object);
+      }
+      feeder.process();
+      double start = threadSeconds();
+      object->process();
+      double elapsed = threadSeconds() - start;
+      metrics.processSeconds += elapsed;
+      metrics.worstFrameSeconds = MAX(metrics.worstFrameSeconds, elapsed);
+
+      float *dst = output.data.data() + frame * FRAMELENGTH * output.channels;
+      for (int c = 0; c < output.channels; c++)
+      {
+        const float *src = outlets[c] ? outlets[c]->buffer() : 0;
+        for (int i = 0; i < FRAMELENGTH; i++)
+        {
+          dst[i * output.channels + c] = src ? src[i] : 0.0f;
+        }
+      }
+    }
+    object->release();
+
+    double sum = 0.0;
+    for (float x : output.data)
+    {
+      metrics.peak = MAX(metrics.peak, fabsf(x));
+      sum += (double)x * x;
+    }
+    metrics.rms = sqrt(sum / MAX((size_t)1, output.data.size()));
+    metrics.audioSeconds = (double)frames * FRAMELENGTH / input.sampleRate;
+    metrics.sampleRate = input.sampleRate;
+
+    metrics.file = getOutputName(grid, values, inputPath);
+    if (!writeWav(settings.outDir + "/" + metrics.file, output))
+    {
+      error = "cannot write " + settings.outDir + "/" + metrics.file;
+      return false;
+    }
+
+    if (!settings.refDir.empty())
+    {
+      Audio ref;
+      std::string ignored;
+      if (readWav(settings.refDir + "/" + metrics.file, ref, ignored))
+      {
+        compare(output, ref, metrics);
+      }
+    }
+
+    metrics.ok = true;
+    return true;
+  }
+
+  static bool withinTolerance(const Settings &settings, const Metrics &metrics)
+  {
+    if (settings.tolerance < 0.0f)
+    {
+      return true;
+    }
+    return metrics.compared && metrics.refMaxDiff <= settings.tolerance;
+  }
+
+  static void printMetrics(const Metrics &metrics)
+  {
+    printf("%.9f %.9f %.6f %d %.9g %.9g %d %.9g %.9g %s\n",
+           metrics.processSeconds, metrics.worstFrameSeconds, metrics.audioSeconds, metrics.sampleRate,
+           metrics.peak, metrics.rms, metrics.compared ? 1 : 0,
+           metrics.refMaxDiff, metrics.refRmsDiff, metrics.file.c_str());
+  }
+
+  static bool parseMetrics(const std::string &line, Metrics &metrics)
+  {
+    std::istringstream words(line);
+    int compared = 0;
+    words >> metrics.processSeconds >> metrics.worstFrameSeconds >> metrics.audioSeconds >> metrics.sampleRate >>
+        metrics.peak >> metrics.rms >> compared >> metrics.refMaxDiff >> metrics.refRmsDiff;
+    words >> std::ws;
+    std::getline(words, metrics.file);
+    metrics.compared = compared != 0;
+    return metrics.sampleRate > 0 && !metrics.file.empty();
+  }
+
+  static std::vector<std::string> buildArguments(const Settings &settings, int job)
+  {
+    std::vector<std::string> args = {"render", "--job", std::to_string(job),
+                                     "-f", std::to_string(settings.frameLength),
+                                     "-o", settings.outDir};
+    if (!settings.refDir.empty())
+    {
+      args.push_back("-r");
+      args.push_back(settings.refDir);
+    }
+    if (settings.tolerance >= 0.0f)
+    {
+      args.push_back("-t");
+      args.push_back(formatValue(settings.tolerance));
+    }
+    args.push_back(settings.gridPath);
+    args.insert(args.end(), settings.inputs.begin(), settings.inputs.end());
+    return args;
+  }
+
+  // Runs one render in a child process and collects what it printed.
+  static void spawnJob(const Settings &settings, int job, Metrics &metrics)
+  {
+    std::vector<std::string> args = buildArguments(settings, job);
+    std::vector<char *> argv;
+    for (std::string &arg : args)
+    {
+      argv.push_back(&arg[0]);
+    }
+    argv.push_back(0);
+
+    // Other workers fork at the same time. Without O_CLOEXEC their children
+    // would inherit this write end and hold off the EOF below until they
+    // exit. dup2 clears the flag on the child's own stdout.
+    int fds[2];
+    if (pipe2(fds, O_CLOEXEC) != 0)
+    {
+      return;
+    }
+
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+      dup2(fds[1], STDOUT_FILENO);
+      close(fds[0]);
+      close(fds[1]);
+      execv("/proc/self/exe", argv.data());
+      _exit(127);
+    }
+    close(fds[1]);
+    if (pid < 0)
+    {
+      close(fds[0]);
+      return;
+    }
+
+    std::string text;
+    char chunk[256];
+    ssize_t n;
+    while ((n = read(fds[0], chunk, sizeof(chunk))) > 0)
+    {
+      text.append(chunk, n);
+    }
+    close(fds[0]);
+
+    int status = 0;
+    struct rusage usage;
+    memset(&usage, 0, sizeof(usage));
+    wait4(pid, &status, 0, &usage);
+
+    metrics.cpuSeconds = usage.ru_utime.tv_sec + usage.ru_utime.tv_usec * 1e-6 +
+                         usage.ru_stime.tv_sec + usage.ru_stime.tv_usec * 1e-6;
+    metrics.maxRssKb = usage.ru_maxrss;
+    if (WIFEXITED(status) && WEXITSTATUS(status) == 0)
+    {
+      metrics.ok = parseMetrics(text, metrics);
+    }
+  }
+
+  static bool writeMetrics(const Settings &settings, const Grid &grid,
+                           const std::vector<Metrics> &results)
+  {
+    std::string path = settings.outDir + "/metrics.csv";
+    FILE *file = fopen(path.c_str(), "w");
+    if (file == 0)
+    {
+      return false;
+    }
+
+    fprintf(file, "object,input,frame_length");
+    for (const Axis &axis : grid.axes)
+    {
+      fprintf(file, ",%s", sanitize(axis.name).c_str());
+    }
+    fprintf(file, ",status,process_s,realtime_factor,worst_frame_load,cpu_s,max_rss_kb,"
+                  "peak,rms,ref_max_diff,ref_rms_diff,file\n");
+
+    int inputCount = settings.inputs.size();
+    for (size_t job = 0; job < results.size(); job++)
+    {
+      const Metrics &metrics = results[job];
+      std::vector<float> values = grid.getCombination(job / inputCount);
+
+      fprintf(file, "%s,%s,%d", grid.object.c_str(),
+              stem(settings.inputs[job % inputCount]).c_str(), settings.frameLength);
+      for (float value : values)
+      {
+        fprintf(file, ",%g", value);
+      }
+
+      if (!metrics.ok)
+      {
+        fprintf(file, ",failed,,,,%.6f,%ld,,,,,\n", metrics.cpuSeconds, metrics.maxRssKb);
+        continue;
+      }
+
+      double framePeriod = (double)settings.frameLength / metrics.sampleRate;
+      double realtime = metrics.processSeconds > 0.0 ? metrics.audioSeconds / metrics.processSeconds : 0.0;
+      fprintf(file, ",%s,%.6f,%.2f,%.4f,%.6f,%ld,%.6g,%.6g,",
+              withinTolerance(settings, metrics) ? "ok" : "mismatch", metrics.processSeconds, realtime,
+              metrics.worstFrameSeconds / framePeriod, metrics.cpuSeconds, metrics.maxRssKb,
+              metrics.peak, metrics.rms);
+      if (metrics.compared)
+      {
+        fprintf(file, "%.6g,%.6g", metrics.refMaxDiff, metrics.refRmsDiff);
+      }
+      else
+      {
+        fprintf(file, ",");
+      }
+      fprintf(file, ",%s\n", metrics.file.c_str());
+    }
+
+    fclose(file);
+    return true;
+  }
+
+  static void usage()
+  {
+    fprintf(stderr,
+            "usage: render [-j threads] [-f frameLength] [-o outdir] [-r refdir [-t tolerance]] grid.txt in.wav...\n"
+            "       render --list\n"
+            "       render --generate out.wav seconds\n");
+  }
+
+  static int generate(const std::string &path, float seconds)
+  {
+    Audio audio;
+    audio.channels = 2;
+    int frames = (int)(MAX(0.0f, seconds) * audio.sampleRate);
+    audio.data.resize(frames * 2);
+
+    // a new burst every 250 ms, the tone rises by a fifth each time
+    int period = audio.sampleRate / 4;
+    uint32_t seed = 1;
+    for (int i = 0; i < frames; i++)
+    {
+      int burst = i / period;
+      float t = (float)(i % period) / audio.sampleRate;
+      float envelope = expf(-12.0f * t);
+      float hz = 220.0f * powf(1.5f, burst % 4);
+      seed = seed * 1664525u + 1013904223u;
+      float noise = (float)(seed >> 8) / (1 << 24) * 2.0f - 1.0f;
+      audio.data[2 * i] = 0.5f * envelope * sinf(2.0f * (float)M_PI * hz * t);
+      audio.data[2 * i + 1] = 0.5f * envelope * envelope * noise;
+    }
+
+    if (!writeWav(path, audio))
+    {
+      fprintf(stderr, "cannot write %s\n", path.c_str());
+      return 1;
+    }
+    return 0;
+  }
+
+  static int listObjects()
+  {
+    for (const ObjectSpec &spec : getObjectSpecs())
+    {
+      printf("%s\n", spec.name);
+    }
+    return 0;
+  }
+
+  int main(int argc, char **argv)
+  {
+    Settings settings;
+    int job = -1;
+
+    int i = 1;
+    for (; i < argc && argv[i][0] == '-'; i++)
+    {
+      std::string flag = argv[i];
+      if (flag == "--list")
+      {
+        return listObjects();
+      }
+      if (flag == "--generate" && i + 2 < argc)
+      {
+        return generate(argv[i + 1], atof(argv[i + 2]));
+      }
+      if (i + 1 >= argc)
+      {
+        usage();
+        return 1;
+      }
+      if (flag == "-j")
+      {
+        settings.threads = atoi(argv[++i]);
+      }
+      else if (flag == "-f")
+      {
+        settings.frameLength = atoi(argv[++i]);
+      }
+      else if (flag == "-o")
+      {
+        settings.outDir = argv[++i];
+      }
+      else if (flag == "-r")
+      {
+        settings.refDir = argv[++i];
+      }
+      else if (flag == "-t")
+      {
+        settings.tolerance = atof(argv[++i]);
+      }
+      else if (flag == "--job")
+      {
+        job = atoi(argv[++i]);
+      }
+      else
+      {
+        usage();
+        return 1;
+      }
+    }
+
+    if (argc - i < 2 || settings.frameLength < 1 || (settings.tolerance >= 0.0f && settings.refDir.empty()))
+    {
+      usage();
+      return 1;
+    }
+    settings.gridPath = argv[i++];
+    settings.inputs.assign(argv + i, argv + argc);
+
+    Grid grid;
+    std::string error;
+    if (!grid.parse(settings.gridPath, error))
+    {
+      fprintf(stderr, "%s\n", error.c_str());
+      return 1;
+    }
+
+    if (job >= 0)
+    {
+      Metrics metrics;
+      if (!renderJob(settings, grid, job, metrics, error))
+      {
+        fprintf(stderr, "job %d: %s\n", job, error.c_str());
+        return 1;
+      }
+      printMetrics(metrics);
+      return 0;
+    }
+
+    if (findObjectSpec(grid.object) == 0)
+    {
+      fprintf(stderr, "unknown object %s, see render --list\n", grid.object.c_str());
+      return 1;
+    }
+    mkdir(settings.outDir.c_str(), 0755);
+
+    int jobs = grid.getCombinationCount() * settings.inputs.size();
+    std::vector<Metrics> results(jobs);
+    ThreadPool pool(settings.threads);
+    std::mutex progress;
+    int done = 0;
+
+    fprintf(stderr, "%d renders on %d threads\n", jobs, pool.getThreadCount());
+    pool.run(jobs, [&](int job, int worker) {
+      spawnJob(settings, job, results[job]);
+      std::lock_guard<std::mutex> guard(progress);
+      done++;
+      fprintf(stderr, "[%d/%d] %s %s\n", done, jobs,
+              results[job].ok ? "ok" : "FAILED", results[job].file.c_str());
+    });
+
+    if (!writeMetrics(settings, grid, results))
+    {
+      fprintf(stderr, "cannot write %s/metrics.csv\n", settings.outDir.c_str());
+      return 1;
+    }
+
+    int failed = 0;
+    int mismatched = 0;
+    for (const Metrics &metrics : results)
+    {
+      failed += metrics.ok ? 0 : 1;
+      mismatched += metrics.ok && !withinTolerance(settings, metrics) ? 1 : 0;
+    }
+    if (mismatched > 0)
+    {
+      fprintf(stderr, "%d of %d renders differ from %s by more than %g\n", mismatched, jobs,
+              settings.refDir.c_str(), settings.tolerance);
+    }
+    return failed > 0 ? 2 : mismatched > 0 ? 3 : 0;
+  }
+
+} /* namespace render */
+
+int main(int argc, char **argv)
+{
+  return render::main(argc, argv);
+}
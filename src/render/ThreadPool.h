@@ -0,0 +1,112 @@
+#pragma once
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace render
+{
+
+  // Runs jobs 0..n-1 on a fixed set of threads. Each worker starts with an
+  // even share of the jobs in its own queue, works from the back of it and,
+  // once empty, steals from the front of the other queues. Renders differ a
+  // lot in length, so nobody sits idle while one worker still has a backlog.
+  class ThreadPool
+  {
+  public:
+    explicit ThreadPool(int threads);
+
+    int getThreadCount();
+    // returns when every job has run, work gets (job, worker)
+    void run(int jobs, const std::function<void(int, int)> &work);
+
+  private:
+    struct Queue
+    {
+      std::mutex lock;
+      std::deque<int> jobs;
+    };
+
+    bool take(int worker, int &job);
+
+    std::vector<std::unique_ptr<Queue>> mQueues;
+  };
+
+  inline ThreadPool::ThreadPool(int threads)
+  {
+    if (threads < 1)
+    {
+      threads = std::thread::hardware_concurrency();
+    }
+    if (threads < 1)
+    {
+      threads = 1;
+    }
+    for (int i = 0; i < threads; i++)
+    {
+      mQueues.emplace_back(new Queue());
+    }
+  }
+
+  inline int ThreadPool::getThreadCount()
+  {
+    return mQueues.size();
+  }
+
+  inline bool ThreadPool::take(int worker, int &job)
+  {
+    {
+      Queue &own = *mQueues[worker];
+      std::lock_guard<std::mutex> guard(own.lock);
+      if (!own.jobs.empty())
+      {
+        job = own.jobs.back();
+        own.jobs.pop_back();
+        return true;
+      }
+    }
+
+    int n = mQueues.size();
+    for (int i = 1; i < n; i++)
+    {
+      Queue &victim = *mQueues[(worker + i) % n];
+      std::lock_guard<std::mutex> guard(victim.lock);
+      if (!victim.jobs.empty())
+      {
+        job = victim.jobs.front();
+        victim.jobs.pop_front();
+        return true;
+      }
+    }
+    return false;
+  }
+
+  inline void ThreadPool::run(int jobs, const std::function<void(int, int)> &work)
+  {
+    int n = mQueues.size();
+    for (int job = 0; job < jobs; job++)
+    {
+      mQueues[job * n / jobs]->jobs.push_back(job);
+    }
+
+    std::vector<std::thread> threads;
+    for (int worker = 0; worker < n; worker++)
+    {
+      threads.emplace_back([this, worker, &work]() {
+        int job;
+        while (take(worker, job))
+        {
+          work(job, worker);
+        }
+      });
+    }
+    for (std::thread &thread : threads)
+    {
+      thread.join();
+    }
+  }
+
+} /* namespace render */
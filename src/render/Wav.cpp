@@ -0,0 +1,174 @@
+#include <Wav.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+namespace render
+{
+
+  int Audio::frames() const
+  {
+    return channels > 0 ? data.size() / channels : 0;
+  }
+
+  float Audio::at(int frame, int channel) const
+  {
+    if (frame < 0 || frame >= frames())
+    {
+      return 0.0f;
+    }
+    return data[frame * channels + (channel < channels ? channel : channels - 1)];
+  }
+
+  static uint32_t le32(const uint8_t *p)
+  {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+  }
+
+  static uint16_t le16(const uint8_t *p)
+  {
+    return p[0] | (p[1] << 8);
+  }
+
+  bool readWav(const std::string &path, Audio &audio, std::string &error)
+  {
+    FILE *file = fopen(path.c_str(), "rb");
+    if (file == 0)
+    {
+      error = "cannot open " + path;
+      return false;
+    }
+
+    std::vector<uint8_t> bytes;
+    uint8_t chunk[65536];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), file)) > 0)
+    {
+      bytes.insert(bytes.end(), chunk, chunk + n);
+    }
+    fclose(file);
+
+    if (bytes.size() < 12 || memcmp(&bytes[0], "RIFF", 4) || memcmp(&bytes[8], "WAVE", 4))
+    {
+      error = path + " is not a WAV file";
+      return false;
+    }
+
+    int format = 0;
+    int bits = 0;
+    size_t pos = 12;
+    while (pos + 8 <= bytes.size())
+    {
+      const uint8_t *p = &bytes[pos];
+      uint32_t size = le32(p + 4);
+      const uint8_t *body = p + 8;
+      if (pos + 8 + size > bytes.size())
+      {
+        size = bytes.size() - pos - 8;
+      }
+
+      if (!memcmp(p, "fmt ", 4) && size >= 16)
+      {
+        format = le16(body);
+        audio.channels = le16(body + 2);
+        audio.sampleRate = le32(body + 4);
+        bits = le16(body + 14);
+        if (format == 0xFFFE && size >= 26)
+        {
+          // WAVE_FORMAT_EXTENSIBLE, the sub-format starts with the format tag
+          format = le16(body + 24);
+        }
+      }
+      else if (!memcmp(p, "data", 4))
+      {
+        if (audio.channels <= 0 || (format != 1 && format != 3))
+        {
+          error = path + ": unsupported WAV format";
+          return false;
+        }
+        int width = bits / 8;
+        size_t count = size / width;
+        audio.data.resize(count);
+        for (size_t i = 0; i < count; i++)
+        {
+          const uint8_t *s = body + i * width;
+          if (format == 3 && bits == 32)
+          {
+            uint32_t u = le32(s);
+            float f;
+            memcpy(&f, &u, sizeof(f));
+            audio.data[i] = f;
+          }
+          else if (format == 1 && bits == 16)
+          {
+            audio.data[i] = (int16_t)le16(s) / 32768.0f;
+          }
+          else if (format == 1 && bits == 24)
+          {
+            int32_t v = (s[0] << 8) | (s[1] << 16) | ((uint32_t)s[2] << 24);
+            audio.data[i] = (v >> 8) / 8388608.0f;
+          }
+          else if (format == 1 && bits == 32)
+          {
+            audio.data[i] = (int32_t)le32(s) / 2147483648.0f;
+          }
+          else
+          {
+            error = path + ": unsupported sample size";
+            return false;
+          }
+        }
+        return true;
+      }
+      pos += 8 + size + (size & 1);
+    }
+
+    error = path + " has no data chunk";
+    return false;
+  }
+
+  static void put32(FILE *file, uint32_t v)
+  {
+    uint8_t b[4] = {(uint8_t)v, (uint8_t)(v >> 8), (uint8_t)(v >> 16), (uint8_t)(v >> 24)};
+    fwrite(b, 1, 4, file);
+  }
+
+  static void put16(FILE *file, uint16_t v)
+  {
+    uint8_t b[2] = {(uint8_t)v, (uint8_t)(v >> 8)};
+    fwrite(b, 1, 2, file);
+  }
+
+  bool writeWav(const std::string &path, const Audio &audio)
+  {
+    FILE *file = fopen(path.c_str(), "wb");
+    if (file == 0)
+    {
+      return false;
+    }
+
+    uint32_t bytes = audio.data.size() * 4;
+    fwrite("RIFF", 1, 4, file);
+    put32(file, 36 + bytes);
+    fwrite("WAVEfmt ", 1, 8, file);
+    put32(file, 16);
+    put16(file, 3);
+    put16(file, audio.channels);
+    put32(file, audio.sampleRate);
+    put32(file, audio.sampleRate * audio.channels * 4);
+    put16(file, audio.channels * 4);
+    put16(file, 32);
+    fwrite("data", 1, 4, file);
+    put32(file, bytes);
+    for (float f : audio.data)
+    {
+      uint32_t u;
+      memcpy(&u, &f, sizeof(u));
+      put32(file, u);
+    }
+    bool ok = !ferror(file);
+    fclose(file);
+    return ok;
+  }
+
+} /* namespace render */
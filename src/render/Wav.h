@@ -0,0 +1,25 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace render
+{
+
+  // Interleaved float audio as read from or written to a WAV file.
+  struct Audio
+  {
+    int sampleRate = 48000;
+    int channels = 1;
+    std::vector<float> data;
+
+    int frames() const;
+    float at(int frame, int channel) const;
+  };
+
+  // Reads 16, 24 and 32 bit PCM and 32 bit float files.
+  bool readWav(const std::string &path, Audio &audio, std::string &error);
+  // Writes 32 bit float.
+  bool writeWav(const std::string &path, const Audio &audio);
+
+} /* namespace render */
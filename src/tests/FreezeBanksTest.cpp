@@ -0,0 +1,86 @@
+// Captures a live history into a freeze bank, then recaptures it and checks
+// that the previous capture is left untouched until the new one swaps in.
+
+#include <Test.h>
+#include <FreezeBanks.h>
+#include <SharedBuffer.h>
+#include <od/config.h>
+
+namespace tests
+{
+
+  static const int historyLength = 20000;
+
+  static void fill(common::SharedBuffer *live, float value)
+  {
+    for (int i = 0; i < historyLength; i++)
+    {
+      live->mpData[i] = value + i;
+    }
+  }
+
+  // runs update() until the bank is ready, at most limit frames
+  static int captureFrames(fdelay::FreezeBanks &banks, common::SharedBuffer *live, int bank, int limit)
+  {
+    for (int frame = 1; frame <= limit; frame++)
+    {
+      banks.update(live, 0);
+      if (banks.isReady(bank) && banks.getSample(bank)->mpData[0] == live->mpData[0])
+      {
+        return frame;
+      }
+    }
+    return -1;
+  }
+
+  static void testRecapture()
+  {
+    common::SharedBuffer *live = new common::SharedBuffer();
+    live->attach();
+    live->allocate(1, historyLength);
+
+    fdelay::FreezeBanks banks;
+    CHECK(banks.allocate(4, historyLength) == 4);
+    CHECK(banks.getSample(1) == 0);
+    CHECK(banks.getLength() == historyLength - FRAMELENGTH);
+
+    fill(live, 0.0f);
+    CHECK(banks.capture(1));
+    CHECK(!banks.capture(1));
+    CHECK(captureFrames(banks, live, 1, 10) > 0);
+    od::Sample *first = banks.getSample(1);
+    CHECK(first != 0);
+    // a grain holds the first capture
+    first->attach();
+
+    fill(live, 1000.0f);
+    CHECK(banks.capture(1));
+    banks.update(live, 0);
+    // still the first capture, unchanged
+    CHECK(banks.getSample(1) == first);
+    bool unchanged = true;
+    for (int i = 0; i < banks.getLength(); i++)
+    {
+      unchanged = unchanged && first->mpData[i] == (float)i;
+    }
+    CHECK(unchanged);
+
+    CHECK(captureFrames(banks, live, 1, 10) > 0);
+    od::Sample *second = banks.getSample(1);
+    CHECK(second != first);
+    CHECK(second->mpData[banks.getLength() - 1] == 1000.0f + banks.getLength() - 1);
+    CHECK(first->mpData[0] == 0.0f);
+
+    first->release();
+    banks.deallocate();
+    live->release();
+  }
+
+} /* namespace tests */
+
+int main()
+{
+  tests::configure(48000, 128);
+  tests::testRecapture();
+  return tests::failures();
+}
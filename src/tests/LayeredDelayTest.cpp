@@ -0,0 +1,297 @@
+// Records one pass into a LayeredDelay the way YLoop drives it and checks
+// that the loop then plays that take from its first sample, and that undo
+// and redo bring back the loop as it was before and after an overdub.
+
+#include <Test.h>
+#include <LayeredDelay.h>
+#include <od/config.h>
+
+namespace tests
+{
+
+  static const int sampleRate = 48000;
+  static const int frameLength = 128;
+
+  struct Rig
+  {
+    yloop::LayeredDelay *delay;
+    Signals signals;
+    float *left, *right, *feedback, *record;
+    std::vector<float> leftOut, rightOut;
+
+    Rig(float undoSecs)
+    {
+      delay = new yloop::LayeredDelay();
+      delay->attach();
+      delay->allocate(2.0f, undoSecs);
+      left = connect("Left In");
+      right = connect("Right In");
+      feedback = connect("Feedback");
+      record = connect("Record");
+    }
+
+    ~Rig()
+    {
+      delay->release();
+    }
+
+    float *connect(const char *name)
+    {
+      od::Outlet *outlet = signals.add();
+      delay->getInput(name)->connect(outlet);
+      return outlet->buffer();
+    }
+
+    void setDelay(float seconds)
+    {
+      delay->getParameter("Left Delay")->hardSet(seconds);
+      delay->getParameter("Right Delay")->hardSet(seconds);
+    }
+
+    void process()
+    {
+      delay->process();
+      float *l = delay->getOutput("Left Out")->buffer();
+      float *r = delay->getOutput("Right Out")->buffer();
+      leftOut.insert(leftOut.end(), l, l + FRAMELENGTH);
+      rightOut.insert(rightOut.end(), r, r + FRAMELENGTH);
+    }
+  };
+
+  // Once holds the delay at its maximum while Record is high and settles on
+  // the length of the take when it falls. The delay follows through a tie, a
+  // frame late. The take is the ramp 1, 2, ..., length.
+  static void recordOnePass(Rig &rig, int start, int length, int frames)
+  {
+    float once = 0.5f;
+    for (int frame = 0; frame < frames; frame++)
+    {
+      rig.setDelay(once);
+      bool gate = false;
+      for (int i = 0; i < FRAMELENGTH; i++)
+      {
+        int n = frame * FRAMELENGTH + i;
+        gate = n >= start && n < start + length;
+        rig.left[i] = gate ? (float)(n - start + 1) : 0.0f;
+        rig.right[i] = -rig.left[i];
+        rig.feedback[i] = 1.0f;
+        rig.record[i] = gate ? 1.0f : 0.0f;
+      }
+      rig.process();
+      if (gate)
+      {
+        once = 2.0f;
+      }
+      else if (once == 2.0f)
+      {
+        once = (float)length / sampleRate;
+      }
+    }
+  }
+
+  // The first loop after the take plays it once in order.
+  static bool playsTake(const std::vector<float> &out, int from, int length, float sign)
+  {
+    int first = from;
+    while (first <= from + length && out[first] != sign)
+    {
+      first++;
+    }
+    if (first + length > (int)out.size())
+    {
+      return false;
+    }
+    for (int j = 0; j < length; j++)
+    {
+      if (out[first + j] != sign * (j + 1))
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  static void testTake(float undoSecs)
+  {
+    const int start = 40 * frameLength + 17;
+    const int length = 20000;
+    const int frames = (start + 4 * length) / frameLength;
+    Rig rig(undoSecs);
+    recordOnePass(rig, start, length, frames);
+    CHECK(playsTake(rig.leftOut, start + length, length, 1.0f));
+    CHECK(playsTake(rig.rightOut, start + length, length, -1.0f));
+  }
+
+  static void testSharedHistory()
+  {
+    const int start = 40 * frameLength + 17;
+    const int length = 20000;
+    const int frames = (start + 2 * length) / frameLength;
+    Rig rig(0.0f);
+    recordOnePass(rig, start, length, frames);
+
+    common::SharedBuffer *buffer = rig.delay->getSharedBuffer();
+    CHECK(buffer != 0);
+    if (buffer)
+    {
+      CHECK(buffer->getLength() == length);
+      // the oldest published frame is the next one the loop plays
+      int oldest = buffer->getHead() - length;
+      if (oldest < 0)
+      {
+        oldest += buffer->mSampleCount;
+      }
+      rig.process();
+      CHECK(buffer->mpData[2 * oldest] == rig.leftOut[frames * FRAMELENGTH]);
+    }
+  }
+
+  // Undo while Record is still held stops the layer and keeps the redo.
+  static void testUndoWhileHeld()
+  {
+    Rig rig(1.0f);
+    rig.setDelay(0.1f);
+    for (int frame = 0; frame < 40; frame++)
+    {
+      if (frame == 25)
+      {
+        rig.delay->undo();
+      }
+      bool gate = frame < 10 || (frame >= 20 && frame < 30);
+      for (int i = 0; i < FRAMELENGTH; i++)
+      {
+        rig.left[i] = rig.right[i] = gate ? 1.0f : 0.0f;
+        rig.feedback[i] = 1.0f;
+        rig.record[i] = gate ? 1.0f : 0.0f;
+      }
+      rig.process();
+      if (frame == 28)
+      {
+        CHECK(rig.delay->getUndoDepth() == 1);
+        CHECK(rig.delay->getRedoDepth() == 1);
+      }
+    }
+    CHECK(rig.delay->getUndoDepth() == 1);
+    CHECK(rig.delay->getRedoDepth() == 1);
+  }
+
+  // A loop of constant length over two pages: take 1 writes 1 everywhere, an
+  // overdub adds 2 on the second page only, and the input's fade out after
+  // Record falls adds 0.5 at the start of the loop, on the first page.
+  struct Overdub
+  {
+    static const int length = 4800;
+    static const int overdub = yloop::LayeredDelay::mPageSize;
+    static const int tail = 100;
+
+    Rig rig;
+    int n = 0;
+
+    Overdub(float undoSecs) : rig(undoSecs)
+    {
+      rig.setDelay((float)length / sampleRate);
+    }
+
+    float input(int m, bool &gate)
+    {
+      int pass = m / length;
+      int k = m % length;
+      gate = pass == 0 || (pass == 2 && k >= overdub);
+      if (pass == 0)
+      {
+        return 1.0f;
+      }
+      if (gate)
+      {
+        return 2.0f;
+      }
+      return pass == 3 && k < tail ? 0.5f : 0.0f;
+    }
+
+    void run(int frames)
+    {
+      for (int frame = 0; frame < frames; frame++, n += FRAMELENGTH)
+      {
+        for (int i = 0; i < FRAMELENGTH; i++)
+        {
+          bool gate;
+          rig.left[i] = input(n + i, gate);
+          rig.right[i] = -rig.left[i];
+          rig.feedback[i] = 1.0f;
+          rig.record[i] = gate ? 1.0f : 0.0f;
+        }
+        rig.process();
+      }
+    }
+
+    // one full loop from the current position, with or without the overdub
+    bool plays(bool overdubbed)
+    {
+      int from = n;
+      run(length / FRAMELENGTH + 2);
+      for (int j = from; j < from + length; j++)
+      {
+        int k = j % length;
+        float expected = 1.0f;
+        if (overdubbed && k < tail)
+        {
+          expected = 1.5f;
+        }
+        else if (overdubbed && k >= overdub)
+        {
+          expected = 3.0f;
+        }
+        if (rig.leftOut[j] != expected || rig.rightOut[j] != -expected)
+        {
+          return false;
+        }
+      }
+      return true;
+    }
+  };
+
+  static void testOverdubUndoRedo()
+  {
+    Overdub o(1.0f);
+    o.run(4 * Overdub::length / FRAMELENGTH);
+    CHECK(o.rig.delay->getUndoDepth() == 2);
+    CHECK(o.plays(true));
+
+    // the fade out changed a page the overdub had not, undo removes it too
+    o.rig.delay->undo();
+    CHECK(o.plays(false));
+    CHECK(o.rig.delay->getUndoDepth() == 1);
+    CHECK(o.rig.delay->getRedoDepth() == 1);
+
+    o.rig.delay->redo();
+    CHECK(o.plays(true));
+    CHECK(o.rig.delay->getUndoDepth() == 2);
+    CHECK(o.rig.delay->getRedoDepth() == 0);
+  }
+
+  // With too few spare pages for the overdub, it can no longer be undone.
+  static void testUndoPoolExhausted()
+  {
+    // one spare page, the loop spans two
+    Overdub o(1.5f * yloop::LayeredDelay::mPageSize / sampleRate);
+    o.run(4 * Overdub::length / FRAMELENGTH);
+    int depth = o.rig.delay->getUndoDepth();
+    o.rig.delay->undo();
+    CHECK(o.plays(true));
+    CHECK(o.rig.delay->getUndoDepth() == depth);
+    CHECK(o.rig.delay->getRedoDepth() == 0);
+  }
+
+} /* namespace tests */
+
+int main()
+{
+  tests::configure(tests::sampleRate, tests::frameLength);
+  tests::testTake(1.0f);
+  tests::testTake(0.0f);
+  tests::testSharedHistory();
+  tests::testUndoWhileHeld();
+  tests::testOverdubUndoRedo();
+  tests::testUndoPoolExhausted();
+  return tests::failures();
+}
@@ -0,0 +1,154 @@
+// Renders one grain in frames of many lengths, including ones that are not a
+// multiple of 4, and checks that each matches a 4-sample-frame reference and
+// never writes past the end of its frame. Also checks that a grain started
+// at any offset inside the frame starts exactly there.
+
+#include <Test.h>
+#include <MonoGrain.h>
+#include <SharedBuffer.h>
+#include <od/config.h>
+#include <algorithm>
+#include <math.h>
+
+namespace tests
+{
+
+  static const int outputLength = 3000;
+  // written past the end of each frame, must survive
+  static const float guard = 12345.0f;
+  static const int guardLength = 4;
+
+  struct Setting
+  {
+    int envelope;
+    float speed;
+    float squash;
+  };
+
+  static std::vector<float> render(common::SharedBuffer *source, int frameLength,
+                                   const Setting &setting, bool &overrun, int delay = 0)
+  {
+    globalConfig.frameLength = frameLength;
+    fdelay::MonoGrain grain;
+    grain.setSample(source);
+    grain.setEnvelope(setting.envelope);
+    if (setting.envelope == 2)
+    {
+      grain.setFade(100);
+    }
+    grain.init(1000, 1500, setting.speed, 0.8f, 0.0f);
+    grain.setDelay(delay);
+    grain.setSquash(setting.squash);
+
+    std::vector<float> out;
+    std::vector<float> frame(frameLength + guardLength);
+    while ((int)out.size() < outputLength)
+    {
+      std::fill(frame.begin(), frame.begin() + frameLength, 0.0f);
+      std::fill(frame.begin() + frameLength, frame.end(), guard);
+      grain.synthesizeFromMonoToMono(frame.data());
+      for (int i = frameLength; i < frameLength + guardLength; i++)
+      {
+        overrun = overrun || frame[i] != guard;
+      }
+      out.insert(out.end(), frame.begin(), frame.begin() + frameLength);
+    }
+    out.resize(outputLength);
+    return out;
+  }
+
+  static void testFrameLengths()
+  {
+    common::SharedBuffer *source = new common::SharedBuffer();
+    source->attach();
+    source->allocate(1, 20000);
+    source->mSampleRate = globalConfig.sampleRate;
+    for (int i = 0; i < 20000; i++)
+    {
+      source->mpData[i] = sinf(i * 0.05f) + 0.3f * sinf(i * 0.31f);
+    }
+
+    const int lengths[] = {16, 20, 32, 48, 50, 64, 96, 100, 127, 128, 200, 255, 256};
+    const float speeds[] = {1.0f, 0.7f, 2.5f, -1.3f};
+    const float squashes[] = {0.0f, 2.0f};
+    for (int envelope = 0; envelope < 3; envelope++)
+    {
+      for (float speed : speeds)
+      {
+        for (float squash : squashes)
+        {
+          Setting setting = {envelope, speed, squash};
+          bool overrun = false;
+          std::vector<float> reference = render(source, 4, setting, overrun);
+          for (int length : lengths)
+          {
+            std::vector<float> out = render(source, length, setting, overrun);
+            float error = 0.0f;
+            for (int i = 0; i < outputLength; i++)
+            {
+              error = fmaxf(error, fabsf(out[i] - reference[i]));
+            }
+            if (error > 1e-4f)
+            {
+              printf("envelope %d speed %g squash %g frame %d: error %g\n",
+                     envelope, speed, squash, length, error);
+            }
+            CHECK(error <= 1e-4f);
+          }
+          CHECK(!overrun);
+        }
+      }
+    }
+
+    source->release();
+  }
+
+  static void testOnsets()
+  {
+    common::SharedBuffer *source = new common::SharedBuffer();
+    source->attach();
+    source->allocate(1, 20000);
+    source->mSampleRate = globalConfig.sampleRate;
+    for (int i = 0; i < 20000; i++)
+    {
+      source->mpData[i] = sinf(i * 0.05f) + 0.3f * sinf(i * 0.31f);
+    }
+
+    for (int envelope = 0; envelope < 3; envelope++)
+    {
+      Setting setting = {envelope, 0.7f, 0.0f};
+      bool overrun = false;
+      std::vector<float> reference = render(source, 128, setting, overrun);
+      for (int delay : {1, 2, 3, 5, 6, 7, 127, 130})
+      {
+        std::vector<float> out = render(source, 128, setting, overrun, delay);
+        float error = 0.0f;
+        for (int i = 0; i < delay; i++)
+        {
+          error = fmaxf(error, fabsf(out[i]));
+        }
+        for (int i = delay; i < outputLength; i++)
+        {
+          error = fmaxf(error, fabsf(out[i] - reference[i - delay]));
+        }
+        if (error > 1e-6f)
+        {
+          printf("envelope %d delay %d: error %g\n", envelope, delay, error);
+        }
+        CHECK(error <= 1e-6f);
+      }
+      CHECK(!overrun);
+    }
+
+    source->release();
+  }
+
+} /* namespace tests */
+
+int main()
+{
+  tests::configure(48000, 128);
+  tests::testFrameLengths();
+  tests::testOnsets();
+  return tests::failures();
+}
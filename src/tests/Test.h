@@ -0,0 +1,60 @@
+#pragma once
+
+#include <od/config.h>
+#include <od/objects/Object.h>
+#include <stdio.h>
+#include <memory>
+#include <sstream>
+#include <vector>
+
+// Helpers for the host tests. Every test is its own program: checks print
+// where they failed and main() returns tests::failures().
+namespace tests
+{
+
+  static int failureCount = 0;
+
+#define CHECK(condition)                                                    \
+  do                                                                        \
+  {                                                                         \
+    if (!(condition))                                                       \
+    {                                                                       \
+      printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+      tests::failureCount++;                                                \
+    }                                                                       \
+  } while (0)
+
+  static inline void configure(int sampleRate, int frameLength)
+  {
+    globalConfig.sampleRate = sampleRate;
+    globalConfig.samplePeriod = 1.0f / sampleRate;
+    globalConfig.frameLength = frameLength;
+  }
+
+  static inline int failures()
+  {
+    if (failureCount > 0)
+    {
+      printf("%d checks failed\n", failureCount);
+    }
+    return failureCount > 0 ? 1 : 0;
+  }
+
+  // Outlets whose buffers the test fills before each frame.
+  class Signals : public od::Object
+  {
+  public:
+    od::Outlet *add()
+    {
+      std::ostringstream name;
+      name << "Out" << mOutlets.size() + 1;
+      mOutlets.emplace_back(new od::Outlet(name.str()));
+      addOutput(*mOutlets.back());
+      return mOutlets.back().get();
+    }
+
+  private:
+    std::vector<std::unique_ptr<od::Outlet>> mOutlets;
+  };
+
+} /* namespace tests */